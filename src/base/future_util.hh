@@ -30,8 +30,10 @@
 #ifndef lnav_future_util_hh
 #define lnav_future_util_hh
 
+#include <atomic>
 #include <deque>
 #include <future>
+#include <vector>
 
 namespace lnav {
 namespace futures {
@@ -64,9 +66,12 @@ class future_queue {
 public:
     /**
      * @param processor The function to execute with the result of a future.
+     * @param max_queue_size The maximum number of futures that can be in
+     *   flight, defaults to MAX_QUEUE_SIZE.
      */
-    explicit future_queue(std::function<void(T&)> processor)
-        : fq_processor(processor){};
+    explicit future_queue(std::function<void(T&)> processor,
+                          size_t max_queue_size = MAX_QUEUE_SIZE)
+        : fq_processor(processor), fq_max_queue_size(max_queue_size){};
 
     ~future_queue()
     {
@@ -75,7 +80,7 @@ public:
 
     /**
      * Add a future to the queue.  If the size of the queue is greater than the
-     * MAX_QUEUE_SIZE, this call will block waiting for the first queued
+     * maximum queue size, this call will block waiting for the first queued
      * future to return a result.
      *
      * @param f The future to add to the queue.
@@ -83,7 +88,7 @@ public:
     void push_back(std::future<T>&& f)
     {
         this->fq_deque.emplace_back(std::move(f));
-        this->pop_to(MAX_QUEUE_SIZE);
+        this->pop_to(this->fq_max_queue_size);
     }
 
     /**
@@ -102,9 +107,44 @@ public:
     }
 
     std::function<void(T&)> fq_processor;
+    size_t fq_max_queue_size;
     std::deque<std::future<T>> fq_deque;
 };
 
+/**
+ * Call a function for each index in [0, count) using up to the given number
+ * of threads.  The indexes are handed out one at a time, so the work stays
+ * balanced when some calls take longer than others.
+ *
+ * @param thread_count The maximum number of threads to use.
+ * @param count The number of indexes.
+ * @param func The function to call with each index.
+ */
+template<typename F>
+void
+parallel_for(size_t thread_count, size_t count, F func)
+{
+    std::atomic<size_t> next{0};
+    auto worker = [&next, count, &func]() {
+        for (auto index = next++; index < count; index = next++) {
+            func(index);
+        }
+    };
+
+    if (thread_count <= 1 || count < 2) {
+        worker();
+        return;
+    }
+
+    std::vector<std::future<void>> workers;
+    for (size_t lpc = 0; lpc < std::min(thread_count, count); lpc++) {
+        workers.emplace_back(std::async(std::launch::async, worker));
+    }
+    for (auto& fut : workers) {
+        fut.get();
+    }
+}
+
 }  // namespace futures
 }  // namespace lnav
 
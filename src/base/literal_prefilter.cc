@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "literal_prefilter.hh"
+
+#include "config.h"
+
+static const std::array<unsigned char, 256> FOLD_TABLE = []() {
+    std::array<unsigned char, 256> retval{};
+
+    for (size_t lpc = 0; lpc < retval.size(); lpc++) {
+        retval[lpc] = ('A' <= lpc && lpc <= 'Z') ? lpc + ('a' - 'A') : lpc;
+    }
+    return retval;
+}();
+
+literal_prefilter::literal_prefilter(
+    const std::vector<std::vector<std::string>>& groups, bool caseless)
+    : lp_caseless(caseless), lp_always(groups.size(), false)
+{
+    for (size_t group = 0; group < groups.size(); group++) {
+        if (groups[group].empty()) {
+            this->lp_always[group] = true;
+            continue;
+        }
+
+        for (const auto& lit : groups[group]) {
+            auto lit_index = this->lp_literals.size();
+
+            if (lit.empty()) {
+                this->lp_always[group] = true;
+                continue;
+            }
+
+            auto first = (unsigned char) lit[0];
+            if (lit.size() == 1) {
+                this->lp_single_bits.set(first);
+                this->lp_singles[first].emplace_back(lit_index);
+            } else {
+                auto key = (uint16_t) (first << 8 | (unsigned char) lit[1]);
+
+                this->lp_pair_bits.set(key);
+                this->lp_pairs[key].emplace_back(lit_index);
+            }
+            this->lp_literals.emplace_back(literal{lit, group});
+        }
+    }
+}
+
+void
+literal_prefilter::scan(string_fragment line,
+                        std::vector<bool>& candidates_out) const
+{
+    if (this->lp_caseless) {
+        this->scan_impl<true>(line, candidates_out);
+    } else {
+        this->scan_impl<false>(line, candidates_out);
+    }
+}
+
+template<bool CASELESS>
+void
+literal_prefilter::scan_impl(string_fragment line,
+                             std::vector<bool>& candidates_out) const
+{
+    const auto* data = line.udata();
+    size_t len = line.length();
+    auto fold = [](unsigned char ch) {
+        return CASELESS ? FOLD_TABLE[ch] : ch;
+    };
+
+    candidates_out = this->lp_always;
+    if (len == 0) {
+        return;
+    }
+
+    auto next_ch = fold(data[0]);
+    for (size_t lpc = 0; lpc < len; lpc++) {
+        auto ch = next_ch;
+
+        if (this->lp_single_bits[ch]) {
+            for (auto lit_index : this->lp_singles[ch]) {
+                candidates_out[this->lp_literals[lit_index].l_group] = true;
+            }
+        }
+        if (lpc + 1 == len) {
+            break;
+        }
+
+        next_ch = fold(data[lpc + 1]);
+        auto key = (uint16_t) (ch << 8 | next_ch);
+        if (!this->lp_pair_bits[key]) {
+            continue;
+        }
+
+        const auto& bucket = this->lp_pairs.find(key)->second;
+        for (auto lit_index : bucket) {
+            const auto& lit = this->lp_literals[lit_index];
+
+            if (candidates_out[lit.l_group] || lit.l_value.size() > len - lpc)
+            {
+                continue;
+            }
+            if (CASELESS) {
+                size_t index = 2;
+
+                while (index < lit.l_value.size()
+                       && fold(data[lpc + index])
+                           == (unsigned char) lit.l_value[index])
+                {
+                    index += 1;
+                }
+                if (index == lit.l_value.size()) {
+                    candidates_out[lit.l_group] = true;
+                }
+            } else if (memcmp(&data[lpc],
+                              lit.l_value.data(),
+                              lit.l_value.size())
+                       == 0)
+            {
+                candidates_out[lit.l_group] = true;
+            }
+        }
+    }
+}
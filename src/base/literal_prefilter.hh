@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_literal_prefilter_hh
+#define lnav_literal_prefilter_hh
+
+#include <array>
+#include <bitset>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "intern_string.hh"
+
+/**
+ * Finds which groups of literal strings are present in a line using a single
+ * pass over the line.  This is used to rule out regexes cheaply, before
+ * running them, by grouping the literals that each regex requires.
+ */
+class literal_prefilter {
+public:
+    /**
+     * @param groups The literals for each group.  A line is a candidate for
+     *   a group if it contains any of the group's literals.  If a group has
+     *   no literals, every line is a candidate for it.
+     * @param caseless If true, the literals must be folded to lowercase and
+     *   the ASCII letters in a line are folded before they are compared.
+     */
+    explicit literal_prefilter(
+        const std::vector<std::vector<std::string>>& groups,
+        bool caseless = false);
+
+    size_t get_group_count() const { return this->lp_always.size(); }
+
+    size_t get_literal_count() const { return this->lp_literals.size(); }
+
+    /**
+     * @return True if lines can be ruled out for the given group.
+     */
+    bool can_rule_out(size_t group) const
+    {
+        return group < this->lp_always.size() && !this->lp_always[group];
+    }
+
+    /**
+     * Find the groups that are candidates for the given line.
+     *
+     * @param line The line to scan.
+     * @param candidates_out Set to the candidacy of each group.
+     */
+    void scan(string_fragment line, std::vector<bool>& candidates_out) const;
+
+private:
+    template<bool CASELESS>
+    void scan_impl(string_fragment line,
+                   std::vector<bool>& candidates_out) const;
+
+    struct literal {
+        std::string l_value;
+        size_t l_group;
+    };
+
+    bool lp_caseless;
+    std::vector<bool> lp_always;
+    std::vector<literal> lp_literals;
+    std::bitset<256> lp_single_bits;
+    std::array<std::vector<size_t>, 256> lp_singles;
+    std::bitset<65536> lp_pair_bits;
+    std::unordered_map<uint16_t, std::vector<size_t>> lp_pairs;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/literal_prefilter.hh"
+
+#include "config.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("literal_prefilter")
+{
+    literal_prefilter lp({
+        {"GET ", "POST "},
+        {"audit:"},
+        {},
+        {"x"},
+    });
+    std::vector<bool> candidates;
+
+    CHECK(lp.get_group_count() == 4);
+    CHECK(lp.can_rule_out(0));
+    CHECK_FALSE(lp.can_rule_out(2));
+
+    lp.scan(string_fragment::from_const("10.0.0.1 POST /home.html"),
+            candidates);
+    CHECK(candidates == std::vector<bool>{true, false, true, false});
+
+    lp.scan(string_fragment::from_const("audit: x"), candidates);
+    CHECK(candidates == std::vector<bool>{false, true, true, true});
+
+    lp.scan(string_fragment::from_const("audit"), candidates);
+    CHECK(candidates == std::vector<bool>{false, false, true, false});
+
+    lp.scan(string_fragment::from_const(""), candidates);
+    CHECK(candidates == std::vector<bool>{false, false, true, false});
+}
+
+TEST_CASE("literal_prefilter-caseless")
+{
+    literal_prefilter lp(
+        {
+            {"connection reset"},
+            {"e"},
+        },
+        true);
+    std::vector<bool> candidates;
+
+    lp.scan(string_fragment::from_const("Connection RESET by peer"),
+            candidates);
+    CHECK(candidates == std::vector<bool>{true, true});
+
+    lp.scan(string_fragment::from_const("connection RESTARTED"), candidates);
+    CHECK(candidates == std::vector<bool>{false, true});
+
+    lp.scan(string_fragment::from_const("CONNECTION"), candidates);
+    CHECK(candidates == std::vector<bool>{false, true});
+
+    lp.scan(string_fragment::from_const("OK"), candidates);
+    CHECK(candidates == std::vector<bool>{false, false});
+}
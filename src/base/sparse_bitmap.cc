@@ -0,0 +1,211 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "sparse_bitmap.hh"
+
+#include "config.h"
+
+bool
+sparse_bitmap::update(size_t index, bool value)
+{
+    auto chunk_index = index / CHUNK_SIZE;
+    auto offset = index % CHUNK_SIZE;
+
+    if (chunk_index >= this->sb_chunks.size()) {
+        if (!value) {
+            return false;
+        }
+        this->sb_chunks.resize(chunk_index + 1);
+    }
+
+    if (value && index >= this->sb_end) {
+        this->sb_end = index + 1;
+    }
+
+    auto& ch = this->sb_chunks[chunk_index];
+
+    if (!ch.c_words.empty()) {
+        auto& word = ch.c_words[offset / 64];
+        auto bit = 1ULL << (offset % 64);
+
+        if (((word & bit) != 0) == value) {
+            return false;
+        }
+        if (value) {
+            word |= bit;
+            ch.c_count += 1;
+            this->sb_count += 1;
+        } else {
+            word &= ~bit;
+            ch.c_count -= 1;
+            this->sb_count -= 1;
+            if (ch.c_count == 0) {
+                ch.c_words.clear();
+                ch.c_words.shrink_to_fit();
+            }
+        }
+        return true;
+    }
+
+    auto& offsets = ch.c_offsets;
+    // Lines are usually added in order, so check the end first.
+    auto iter = (offsets.empty() || offsets.back() < offset)
+        ? offsets.end()
+        : std::lower_bound(offsets.begin(), offsets.end(), offset);
+    auto present = iter != offsets.end() && *iter == offset;
+
+    if (present == value) {
+        return false;
+    }
+    if (!value) {
+        offsets.erase(iter);
+        ch.c_count -= 1;
+        this->sb_count -= 1;
+        return true;
+    }
+
+    offsets.insert(iter, offset);
+    ch.c_count += 1;
+    this->sb_count += 1;
+    if (offsets.size() > MAX_ARRAY_SIZE) {
+        ch.c_words.resize(WORDS_PER_CHUNK);
+        for (auto off : offsets) {
+            ch.c_words[off / 64] |= 1ULL << (off % 64);
+        }
+        offsets.clear();
+        offsets.shrink_to_fit();
+    }
+
+    return true;
+}
+
+bool
+sparse_bitmap::test(size_t index) const
+{
+    auto chunk_index = index / CHUNK_SIZE;
+    auto offset = index % CHUNK_SIZE;
+
+    if (chunk_index >= this->sb_chunks.size()) {
+        return false;
+    }
+
+    const auto& ch = this->sb_chunks[chunk_index];
+
+    if (!ch.c_words.empty()) {
+        return (ch.c_words[offset / 64] >> (offset % 64)) & 1;
+    }
+
+    return std::binary_search(
+        ch.c_offsets.begin(), ch.c_offsets.end(), (uint16_t) offset);
+}
+
+void
+sparse_bitmap::clear()
+{
+    this->sb_chunks.clear();
+    this->sb_count = 0;
+    this->sb_end = 0;
+}
+
+void
+sparse_bitmap::truncate(size_t size)
+{
+    auto chunk_index = size / CHUNK_SIZE;
+    auto offset = size % CHUNK_SIZE;
+
+    this->sb_end = std::min(this->sb_end, size);
+    while (this->sb_chunks.size() > chunk_index + 1) {
+        this->sb_count -= this->sb_chunks.back().c_count;
+        this->sb_chunks.pop_back();
+    }
+    if (chunk_index >= this->sb_chunks.size()) {
+        return;
+    }
+
+    auto& ch = this->sb_chunks[chunk_index];
+    size_t remaining = 0;
+
+    if (!ch.c_words.empty()) {
+        for (size_t lpc = 0; lpc < WORDS_PER_CHUNK; lpc++) {
+            if (lpc * 64 >= offset) {
+                ch.c_words[lpc] = 0;
+            } else if ((lpc + 1) * 64 > offset) {
+                ch.c_words[lpc] &= (1ULL << (offset % 64)) - 1;
+            }
+            remaining += __builtin_popcountll(ch.c_words[lpc]);
+        }
+        if (remaining == 0) {
+            ch.c_words.clear();
+            ch.c_words.shrink_to_fit();
+        }
+    } else {
+        auto iter = std::lower_bound(
+            ch.c_offsets.begin(), ch.c_offsets.end(), offset);
+
+        ch.c_offsets.erase(iter, ch.c_offsets.end());
+        remaining = ch.c_offsets.size();
+    }
+    this->sb_count -= ch.c_count - remaining;
+    ch.c_count = remaining;
+}
+
+void
+sparse_bitmap::or_chunk_into(size_t chunk, uint64_t* words) const
+{
+    if (chunk >= this->sb_chunks.size()) {
+        return;
+    }
+
+    const auto& ch = this->sb_chunks[chunk];
+
+    if (!ch.c_words.empty()) {
+        for (size_t lpc = 0; lpc < WORDS_PER_CHUNK; lpc++) {
+            words[lpc] |= ch.c_words[lpc];
+        }
+        return;
+    }
+    for (auto off : ch.c_offsets) {
+        words[off / 64] |= 1ULL << (off % 64);
+    }
+}
+
+size_t
+sparse_bitmap::get_memory_usage() const
+{
+    auto retval = this->sb_chunks.capacity() * sizeof(chunk);
+
+    for (const auto& ch : this->sb_chunks) {
+        retval += ch.c_offsets.capacity() * sizeof(uint16_t)
+            + ch.c_words.capacity() * sizeof(uint64_t);
+    }
+
+    return retval;
+}
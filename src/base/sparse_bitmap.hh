@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_sparse_bitmap_hh
+#define lnav_sparse_bitmap_hh
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/**
+ * A bitmap that is split into chunks of CHUNK_SIZE bits.  A chunk with few
+ * bits set is stored as a sorted array of the offsets of the bits and is
+ * converted to a plain bitmap once it has too many, so a sparse bitmap takes
+ * up little space while a dense one is still fast to update.
+ */
+class sparse_bitmap {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t WORDS_PER_CHUNK = CHUNK_SIZE / 64;
+
+    /**
+     * @param index The bit to change.
+     * @param value The new value for the bit.
+     * @return True if the bit was changed.
+     */
+    bool set(size_t index, bool value = true)
+    {
+        // Bits are usually cleared after the last one that was set, so that
+        // case is handled without a call.
+        if (!value && index >= this->sb_end) {
+            return false;
+        }
+        return this->update(index, value);
+    }
+
+    bool test(size_t index) const;
+
+    /** @return The number of bits that are set. */
+    size_t count() const { return this->sb_count; }
+
+    bool empty() const { return this->sb_count == 0; }
+
+    void clear();
+
+    /** Clear the bits at or after the given index. */
+    void truncate(size_t size);
+
+    /**
+     * OR the bits in a chunk into an array.
+     *
+     * @param chunk The index of the chunk.
+     * @param words The destination array of WORDS_PER_CHUNK words.
+     */
+    void or_chunk_into(size_t chunk, uint64_t* words) const;
+
+    size_t get_memory_usage() const;
+
+private:
+    bool update(size_t index, bool value);
+
+    /**
+     * The most offsets to keep in a chunk's array, at this size the array
+     * takes up as much space as the plain bitmap.
+     */
+    static constexpr size_t MAX_ARRAY_SIZE = WORDS_PER_CHUNK * 4;
+
+    struct chunk {
+        /** The sorted offsets of the bits that are set, if c_words is empty. */
+        std::vector<uint16_t> c_offsets;
+        std::vector<uint64_t> c_words;
+        size_t c_count{0};
+    };
+
+    std::vector<chunk> sb_chunks;
+    size_t sb_count{0};
+    /** An index that is past all of the bits that are set. */
+    size_t sb_end{0};
+};
+
+#endif
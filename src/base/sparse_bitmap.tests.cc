@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/sparse_bitmap.hh"
+
+#include "config.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("sparse_bitmap")
+{
+    sparse_bitmap sb;
+
+    CHECK(sb.empty());
+    CHECK_FALSE(sb.test(10));
+    CHECK_FALSE(sb.set(10, false));
+
+    CHECK(sb.set(10));
+    CHECK_FALSE(sb.set(10));
+    CHECK(sb.set(5));
+    CHECK(sb.set(sparse_bitmap::CHUNK_SIZE * 3 + 1));
+    CHECK(sb.count() == 3);
+    CHECK(sb.test(5));
+    CHECK(sb.test(10));
+    CHECK_FALSE(sb.test(11));
+    CHECK(sb.test(sparse_bitmap::CHUNK_SIZE * 3 + 1));
+
+    CHECK(sb.set(10, false));
+    CHECK_FALSE(sb.test(10));
+    CHECK(sb.count() == 2);
+
+    sb.set(20);
+    sb.truncate(sparse_bitmap::CHUNK_SIZE * 3 + 2);
+    CHECK(sb.count() == 3);
+    sb.truncate(20);
+    CHECK(sb.count() == 1);
+    CHECK(sb.test(5));
+    CHECK_FALSE(sb.test(20));
+    CHECK_FALSE(sb.test(sparse_bitmap::CHUNK_SIZE * 3 + 1));
+
+    std::vector<uint64_t> words(sparse_bitmap::WORDS_PER_CHUNK);
+    sb.or_chunk_into(0, words.data());
+    CHECK(words[0] == (1ULL << 5));
+    sb.or_chunk_into(3, words.data());
+    CHECK(words[0] == (1ULL << 5));
+
+    sb.clear();
+    CHECK(sb.empty());
+    CHECK_FALSE(sb.test(5));
+}
+
+TEST_CASE("sparse_bitmap-dense")
+{
+    sparse_bitmap sb;
+    auto sparse_usage = size_t{0};
+
+    for (size_t lpc = 0; lpc < sparse_bitmap::CHUNK_SIZE; lpc += 2) {
+        sb.set(lpc);
+        if (lpc == 1000) {
+            sparse_usage = sb.get_memory_usage();
+        }
+    }
+    CHECK(sb.count() == sparse_bitmap::CHUNK_SIZE / 2);
+    CHECK(sparse_usage < 2048);
+    CHECK(sb.get_memory_usage() < sparse_bitmap::CHUNK_SIZE / 8 + 1024);
+    CHECK(sb.test(1000));
+    CHECK_FALSE(sb.test(1001));
+
+    std::vector<uint64_t> words(sparse_bitmap::WORDS_PER_CHUNK);
+    sb.or_chunk_into(0, words.data());
+    CHECK(words[0] == 0x5555555555555555ULL);
+
+    sb.truncate(1000);
+    CHECK(sb.count() == 500);
+    CHECK_FALSE(sb.test(1000));
+    CHECK(sb.test(998));
+
+    for (size_t lpc = 0; lpc < 1000; lpc += 2) {
+        sb.set(lpc, false);
+    }
+    CHECK(sb.empty());
+    CHECK_FALSE(sb.test(1000));
+}
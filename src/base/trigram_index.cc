@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+
+#include "trigram_index.hh"
+
+#include "config.h"
+
+static std::atomic<uint64_t> NEXT_GENERATION{1};
+
+static inline uint8_t
+fold(uint8_t ch)
+{
+    if ('A' <= ch && ch <= 'Z') {
+        return ch + ('a' - 'A');
+    }
+    return ch;
+}
+
+trigram_index::query::query(const std::vector<std::string>& folded_literals)
+{
+    for (const auto& lit : folded_literals) {
+        for (size_t lpc = 0; lpc + 2 < lit.size(); lpc++) {
+            auto b1 = (uint8_t) lit[lpc];
+            auto b2 = (uint8_t) lit[lpc + 1];
+            auto b3 = (uint8_t) lit[lpc + 2];
+
+            // Non-ASCII characters can be folded in ways that the index does
+            // not know about, so skip them.
+            if ((b1 | b2 | b3) & 0x80) {
+                continue;
+            }
+            this->q_buckets.emplace_back(bucket_for(b1, b2, b3));
+        }
+    }
+
+    std::sort(this->q_buckets.begin(), this->q_buckets.end());
+    this->q_buckets.erase(
+        std::unique(this->q_buckets.begin(), this->q_buckets.end()),
+        this->q_buckets.end());
+}
+
+trigram_index::trigram_index() : ti_generation(NEXT_GENERATION++) {}
+
+uint16_t
+trigram_index::bucket_for(uint8_t b1, uint8_t b2, uint8_t b3)
+{
+    uint32_t key = (uint32_t) b1 << 16 | (uint32_t) b2 << 8 | b3;
+
+    return (key * 2654435761U) >> 20;
+}
+
+void
+trigram_index::clear()
+{
+    this->ti_generation = NEXT_GENERATION++;
+    this->ti_line_count = 0;
+    this->ti_base_group = 0;
+    this->ti_words.clear();
+    this->ti_words.shrink_to_fit();
+    this->ti_unindexed.clear();
+    this->ti_unindexed.shrink_to_fit();
+}
+
+void
+trigram_index::ensure_block(size_t block)
+{
+    auto group = block / 64;
+
+    if (this->ti_line_count == 0 && this->ti_unindexed.empty()) {
+        this->ti_base_group = group;
+    }
+
+    auto group_count = group + 1 - this->ti_base_group;
+    if (group_count > this->ti_unindexed.size()) {
+        this->ti_unindexed.resize(group_count, 0);
+        this->ti_words.resize(group_count * BUCKET_COUNT, 0);
+    }
+}
+
+void
+trigram_index::mark_unindexed(size_t begin, size_t end)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    auto first_block = begin / LINES_PER_BLOCK;
+    auto last_block = (end - 1) / LINES_PER_BLOCK;
+
+    if (this->ti_line_count == 0 && this->ti_unindexed.empty()) {
+        // The groups before the first line are not stored at all.
+        first_block = std::max(first_block, (last_block / 64) * 64);
+    }
+    this->ensure_block(last_block);
+    for (auto block = first_block; block <= last_block; block++) {
+        auto group = block / 64 - this->ti_base_group;
+
+        this->ti_unindexed[group] |= 1ULL << (block % 64);
+    }
+}
+
+void
+trigram_index::add_line(size_t line, string_fragment sf)
+{
+    auto block = line / LINES_PER_BLOCK;
+
+    this->mark_unindexed(this->ti_line_count, line);
+    this->ensure_block(block);
+    this->ti_line_count = std::max(this->ti_line_count, line + 1);
+
+    if (sf.length() < 3) {
+        return;
+    }
+
+    auto* words
+        = &this->ti_words[(block / 64 - this->ti_base_group) * BUCKET_COUNT];
+    auto bit = 1ULL << (block % 64);
+    const auto* data = (const uint8_t*) sf.data();
+    auto b1 = fold(data[0]);
+    auto b2 = fold(data[1]);
+
+    for (int lpc = 2; lpc < sf.length(); lpc++) {
+        auto b3 = fold(data[lpc]);
+
+        words[bucket_for(b1, b2, b3)] |= bit;
+        b1 = b2;
+        b2 = b3;
+    }
+}
+
+void
+trigram_index::add_unindexed_line(size_t line)
+{
+    this->mark_unindexed(this->ti_line_count, line + 1);
+    this->ti_line_count = std::max(this->ti_line_count, line + 1);
+}
+
+void
+trigram_index::update(const query& q, block_set& bs) const
+{
+    if (bs.bs_generation != this->ti_generation) {
+        bs.bs_generation = this->ti_generation;
+        bs.bs_line_count = 0;
+        bs.bs_words.clear();
+    }
+
+    if (q.empty() || this->ti_line_count == 0) {
+        return;
+    }
+
+    // The block with the last line is not included since the line might be
+    // added again once the rest of it has been read.
+    auto full_blocks = (this->ti_line_count - 1) / LINES_PER_BLOCK;
+    if (full_blocks * LINES_PER_BLOCK <= bs.bs_line_count) {
+        return;
+    }
+
+    auto first_group = bs.bs_line_count / LINES_PER_BLOCK / 64;
+    auto group_count = (full_blocks + 63) / 64;
+
+    bs.bs_words.resize(group_count);
+    for (auto group = first_group; group < group_count; group++) {
+        if (group < this->ti_base_group) {
+            bs.bs_words[group] = ~0ULL;
+            continue;
+        }
+
+        auto stored_group = group - this->ti_base_group;
+        const auto* words = &this->ti_words[stored_group * BUCKET_COUNT];
+        auto word = ~0ULL;
+
+        for (const auto bucket : q.q_buckets) {
+            word &= words[bucket];
+        }
+        bs.bs_words[group] = word | this->ti_unindexed[stored_group];
+    }
+    bs.bs_line_count = full_blocks * LINES_PER_BLOCK;
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_trigram_index_hh
+#define lnav_trigram_index_hh
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "intern_string.hh"
+
+/**
+ * An index of the three-byte sequences, folded to lowercase, in the lines of
+ * a file.  The lines are grouped into blocks and each trigram is hashed into
+ * a bucket.  A bucket has a bitmap of the blocks that contain one of its
+ * trigrams, so the blocks that might contain a set of literals are found by
+ * intersecting the bitmaps for the literals' trigrams.  Lines are added in
+ * order as they are indexed and the bits are never cleared, so a lookup can
+ * only return extra blocks and never miss one.
+ */
+class trigram_index {
+public:
+    static constexpr size_t LINES_PER_BLOCK = 64;
+    static constexpr size_t BUCKET_COUNT = 4096;
+
+    /** The buckets for the trigrams of a set of literals. */
+    class query {
+    public:
+        query() = default;
+
+        /**
+         * @param folded_literals Literals, folded to lowercase, that must
+         *   all be present in a line.
+         */
+        explicit query(const std::vector<std::string>& folded_literals);
+
+        /** @return True if the literals did not have any usable trigrams. */
+        bool empty() const { return this->q_buckets.empty(); }
+
+    private:
+        friend trigram_index;
+
+        std::vector<uint16_t> q_buckets;
+    };
+
+    /** The blocks that were found by a query. */
+    class block_set {
+    public:
+        /**
+         * @return False if the line is known to not contain the literals in
+         * the query.
+         */
+        bool might_contain(size_t line) const
+        {
+            if (line >= this->bs_line_count) {
+                return true;
+            }
+
+            auto block = line / LINES_PER_BLOCK;
+
+            return (this->bs_words[block / 64] >> (block % 64)) & 1;
+        }
+
+        /** @return The number of lines covered by this set. */
+        size_t get_line_count() const { return this->bs_line_count; }
+
+    private:
+        friend trigram_index;
+
+        uint64_t bs_generation{0};
+        size_t bs_line_count{0};
+        std::vector<uint64_t> bs_words;
+    };
+
+    trigram_index();
+
+    /**
+     * Add the trigrams in a line to the index.  Adding a line again, like
+     * when a partial line is completed, is allowed.
+     *
+     * @param line The number of the line in the file.
+     * @param sf The line's content.
+     */
+    void add_line(size_t line, string_fragment sf);
+
+    /**
+     * Mark a line as not being indexed.  The block containing the line will
+     * be returned by all queries.
+     */
+    void add_unindexed_line(size_t line);
+
+    void clear();
+
+    /** @return The number of lines that have been added to the index. */
+    size_t get_line_count() const { return this->ti_line_count; }
+
+    size_t get_memory_usage() const
+    {
+        return (this->ti_words.capacity() + this->ti_unindexed.capacity())
+            * sizeof(uint64_t);
+    }
+
+    /**
+     * Update a set of blocks for the lines that have been added to the index
+     * since the set was last updated.  Only the blocks that have been filled
+     * are included in the set, lines after those are always considered to
+     * be candidates.
+     *
+     * @param q The query to run.
+     * @param bs The set to update.
+     */
+    void update(const query& q, block_set& bs) const;
+
+private:
+    void ensure_block(size_t block);
+
+    static uint16_t bucket_for(uint8_t b1, uint8_t b2, uint8_t b3);
+
+    void mark_unindexed(size_t begin, size_t end);
+
+    /** Unique value used to detect block_sets from another index. */
+    uint64_t ti_generation;
+    size_t ti_line_count{0};
+    /**
+     * The first group of blocks that is stored.  The lines before the first
+     * one that was added, like the ones restored from the index cache, are
+     * not indexed and do not take up any space.
+     */
+    size_t ti_base_group{0};
+    /**
+     * The bucket bitmaps, each group of 64 blocks is stored as BUCKET_COUNT
+     * words so that a query reads the words for a group close together.
+     */
+    std::vector<uint64_t> ti_words;
+    /** Bitmap of blocks that contain unindexed lines. */
+    std::vector<uint64_t> ti_unindexed;
+};
+
+#endif
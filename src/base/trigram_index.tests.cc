@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/trigram_index.hh"
+
+#include "config.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("trigram_index")
+{
+    trigram_index ti;
+    trigram_index::query q({"request-id"});
+    trigram_index::query empty_q({"ab"});
+    trigram_index::block_set bs;
+
+    CHECK(empty_q.empty());
+
+    for (size_t lpc = 0; lpc < 10 * trigram_index::LINES_PER_BLOCK; lpc++) {
+        if (lpc == 130) {
+            ti.add_line(lpc,
+                        string_fragment::from_const("GET /x Request-ID=1"));
+        } else if (lpc == 300) {
+            ti.add_unindexed_line(lpc);
+        } else {
+            ti.add_line(lpc, string_fragment::from_const("GET /x id=1"));
+        }
+    }
+    ti.update(q, bs);
+
+    CHECK(bs.get_line_count() == 9 * trigram_index::LINES_PER_BLOCK);
+    CHECK_FALSE(bs.might_contain(0));
+    CHECK(bs.might_contain(130));
+    CHECK(bs.might_contain(128));
+    CHECK_FALSE(bs.might_contain(200));
+    CHECK(bs.might_contain(300));
+    CHECK(bs.might_contain(9 * trigram_index::LINES_PER_BLOCK));
+
+    // The last block is only included once the following lines are added.
+    ti.add_line(9 * trigram_index::LINES_PER_BLOCK + 1,
+                string_fragment::from_const("request-id"));
+    ti.add_line(10 * trigram_index::LINES_PER_BLOCK,
+                string_fragment::from_const("nothing"));
+    ti.update(q, bs);
+    CHECK(bs.get_line_count() == 10 * trigram_index::LINES_PER_BLOCK);
+    CHECK(bs.might_contain(9 * trigram_index::LINES_PER_BLOCK));
+    CHECK_FALSE(bs.might_contain(200));
+
+    ti.clear();
+    ti.update(q, bs);
+    CHECK(bs.get_line_count() == 0);
+    CHECK(bs.might_contain(0));
+}
+
+TEST_CASE("trigram_index-gap")
+{
+    trigram_index ti;
+    trigram_index::query q({"needle"});
+    trigram_index::block_set bs;
+    size_t start = 100000;
+
+    for (size_t lpc = start; lpc < start + 1000; lpc++) {
+        ti.add_line(lpc, string_fragment::from_const("haystack"));
+    }
+    ti.update(q, bs);
+
+    CHECK(ti.get_memory_usage() < 200 * 1024);
+    CHECK(bs.might_contain(0));
+    CHECK(bs.might_contain(start - 1));
+    CHECK_FALSE(bs.might_contain(start + 100));
+}
@@ -32,6 +32,7 @@
 #ifndef lnav_big_array_hh
 #define lnav_big_array_hh
 
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -46,21 +47,23 @@ struct big_array {
 
                                        };
 
+    /**
+     * Make sure there is room for the given number of elements.  Any
+     * existing elements are carried over to the new mapping.
+     *
+     * @param size The number of elements to reserve space for.
+     * @return True if the array was moved to a new mapping.
+     */
     bool reserve(size_t size)
     {
         if (size < this->ba_capacity) {
             return false;
         }
 
-        if (this->ba_ptr) {
-            munmap(this->ba_ptr,
-                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()));
-        }
-
-        this->ba_capacity = size + DEFAULT_INCREMENT;
+        auto new_capacity = size + DEFAULT_INCREMENT;
         void* result
             = mmap(nullptr,
-                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()),
+                   roundup_size(new_capacity * sizeof(T), getpagesize()),
                    PROT_READ | PROT_WRITE,
                    MAP_ANONYMOUS | MAP_PRIVATE,
                    -1,
@@ -68,7 +71,14 @@ struct big_array {
 
         ensure(result != MAP_FAILED);
 
+        if (this->ba_ptr) {
+            memcpy(result, this->ba_ptr, this->ba_size * sizeof(T));
+            munmap(this->ba_ptr,
+                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()));
+        }
+
         this->ba_ptr = (T*) result;
+        this->ba_capacity = new_capacity;
 
         return true;
     };
@@ -90,6 +90,12 @@ public:
 
         require(vl >= 0);
 
+        // Bookmarks are usually added in order, so avoid the search.
+        if (this->empty() || this->back() < vl) {
+            this->push_back(vl);
+            return this->end();
+        }
+
         auto lb = std::lower_bound(this->begin(), this->end(), vl);
         if (lb == this->end() || *lb != vl) {
             this->insert(lb, vl);
@@ -101,6 +107,36 @@ public:
         return retval;
     }
 
+    /**
+     * Insert a batch of bookmarks that are not already in the vector.  The
+     * batch does not need to be sorted and is merged in a single pass, so
+     * this should be used instead of insert_once() when lines are found out
+     * of order.
+     *
+     * @param lines The lines to bookmark, the vector is cleared on return.
+     */
+    void insert_batch(std::vector<LineType>& lines)
+    {
+        if (lines.empty()) {
+            return;
+        }
+
+        std::sort(lines.begin(), lines.end());
+
+        auto old_size = this->size();
+        auto merge_start = std::lower_bound(
+                               this->begin(), this->end(), lines.front())
+            - this->begin();
+
+        this->insert(this->end(), lines.begin(), lines.end());
+        std::inplace_merge(this->begin() + merge_start,
+                           this->begin() + old_size,
+                           this->end());
+        this->erase(std::unique(this->begin() + merge_start, this->end()),
+                    this->end());
+        lines.clear();
+    }
+
     std::pair<iterator, iterator> equal_range(LineType start, LineType stop)
     {
         auto lb = std::lower_bound(this->begin(), this->end(), start);
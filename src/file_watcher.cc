@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "file_watcher.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base/lnav_log.hh"
+#include "config.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#    include <sys/inotify.h>
+
+static constexpr uint32_t FILE_EVENTS
+    = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+static constexpr uint32_t DIR_EVENTS
+    = IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+#endif
+
+file_watcher::file_watcher(std::shared_ptr<pollable_supervisor> supervisor)
+    : pollable(supervisor, pollable::category::background)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    this->fw_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fw_fd == -1) {
+        log_error("unable to initialize inotify -- %s", strerror(errno));
+    }
+#endif
+}
+
+void
+file_watcher::sync(const std::set<std::string>& files,
+                   const std::set<std::string>& dirs)
+{
+    size_t unwatched = 0;
+
+    unwatched += this->sync_paths(files, false);
+    unwatched += this->sync_paths(dirs, true);
+    if (this->fw_fd == -1) {
+        unwatched += files.size() + dirs.size();
+    }
+
+    if (this->fw_watching_all != (unwatched == 0)) {
+        log_info("file watcher is %s",
+                 unwatched == 0 ? "watching all paths"
+                                : "missing some paths, polling");
+    }
+    this->fw_watching_all = unwatched == 0;
+}
+
+size_t
+file_watcher::sync_paths(const std::set<std::string>& paths, bool dir)
+{
+    size_t retval = 0;
+
+    if (this->fw_fd == -1) {
+        return retval;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    auto iter = this->fw_watches.begin();
+    while (iter != this->fw_watches.end()) {
+        if (iter->second.w_dir == dir
+            && paths.find(iter->first) == paths.end())
+        {
+            auto wd = iter->second.w_descriptor;
+
+            iter = this->fw_watches.erase(iter);
+            auto& desc = this->fw_descriptors[wd];
+            desc.d_refs -= 1;
+            if (desc.d_refs == 0) {
+                this->fw_descriptors.erase(wd);
+                inotify_rm_watch(this->fw_fd, wd);
+            }
+        } else {
+            ++iter;
+        }
+    }
+
+    for (const auto& path : paths) {
+        if (this->fw_watches.find(path) != this->fw_watches.end()) {
+            continue;
+        }
+
+        auto wd = inotify_add_watch(
+            this->fw_fd, path.c_str(), dir ? DIR_EVENTS : FILE_EVENTS);
+        if (wd == -1) {
+            log_debug("unable to watch %s -- %s", path.c_str(), strerror(errno));
+            retval += 1;
+            continue;
+        }
+
+        this->fw_watches[path] = watch{wd, dir};
+        auto& desc = this->fw_descriptors[wd];
+        desc.d_refs += 1;
+        desc.d_dir = dir;
+    }
+#endif
+
+    return retval;
+}
+
+void
+file_watcher::remove_descriptor(int wd)
+{
+    auto iter = this->fw_watches.begin();
+    while (iter != this->fw_watches.end()) {
+        if (iter->second.w_descriptor == wd) {
+            iter = this->fw_watches.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    this->fw_descriptors.erase(wd);
+    // The path will be watched again on the next sync, if it still exists.
+    this->fw_watching_all = false;
+}
+
+file_watcher::changes
+file_watcher::consume_changes()
+{
+    auto retval = this->fw_changes;
+
+    this->fw_changes = changes{};
+    return retval;
+}
+
+void
+file_watcher::update_poll_set(std::vector<struct pollfd>& pollfds)
+{
+    if (this->fw_fd != -1) {
+        pollfds.push_back((struct pollfd){this->fw_fd, POLLIN, 0});
+    }
+}
+
+void
+file_watcher::check_poll_set(const std::vector<struct pollfd>& pollfds)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (this->fw_fd == -1 || !pollfd_ready(pollfds, this->fw_fd)) {
+        return;
+    }
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t rc;
+
+    while ((rc = read(this->fw_fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t off = 0; off < rc;) {
+            const auto* event = (const struct inotify_event*) &buffer[off];
+
+            off += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                this->fw_changes.c_files = true;
+                this->fw_changes.c_dirs = true;
+                continue;
+            }
+
+            auto desc_iter = this->fw_descriptors.find(event->wd);
+            auto is_dir = desc_iter != this->fw_descriptors.end()
+                && desc_iter->second.d_dir;
+            if (event->mask & (IN_IGNORED | IN_MOVE_SELF | IN_DELETE_SELF)) {
+                // The file was removed or renamed, which is handled by a
+                // rescan.
+                this->fw_changes.c_dirs = true;
+                if (event->mask & IN_IGNORED) {
+                    this->remove_descriptor(event->wd);
+                }
+            }
+            if (is_dir) {
+                this->fw_changes.c_dirs = true;
+            } else {
+                this->fw_changes.c_files = true;
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_file_watcher_hh
+#define lnav_file_watcher_hh
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/auto_fd.hh"
+#include "pollable.hh"
+
+/**
+ * Watches the open files, and the directories that new files can show up
+ * in, for changes using inotify(7).  The main loop uses the changes to
+ * start indexing or rescanning right away instead of waiting for the next
+ * poll.  If inotify is not available or a path cannot be watched, the main
+ * loop keeps polling at the regular interval.
+ */
+class file_watcher : public pollable {
+public:
+    struct changes {
+        bool c_files{false};
+        bool c_dirs{false};
+    };
+
+    explicit file_watcher(std::shared_ptr<pollable_supervisor> supervisor);
+
+    using injectable = file_watcher(std::shared_ptr<pollable_supervisor>);
+
+    /**
+     * @return True if all of the paths passed to the last call to sync()
+     * are being watched.
+     */
+    bool is_watching_all() const { return this->fw_watching_all; }
+
+    /**
+     * Update the set of watched paths to match the given files and
+     * directories.
+     *
+     * @param files The paths of the files whose contents should be watched.
+     * @param dirs The directories to watch for new or removed entries.
+     */
+    void sync(const std::set<std::string>& files,
+              const std::set<std::string>& dirs);
+
+    /**
+     * @return The changes that were observed since the last call.
+     */
+    changes consume_changes();
+
+    void update_poll_set(std::vector<struct pollfd>& pollfds) override;
+
+    void check_poll_set(const std::vector<struct pollfd>& pollfds) override;
+
+private:
+    struct watch {
+        int w_descriptor;
+        bool w_dir;
+    };
+
+    struct descriptor {
+        size_t d_refs{0};
+        bool d_dir{false};
+    };
+
+    size_t sync_paths(const std::set<std::string>& paths, bool dir);
+
+    void remove_descriptor(int wd);
+
+    auto_fd fw_fd;
+    std::map<std::string, watch> fw_watches;
+    std::map<int, descriptor> fw_descriptors;
+    bool fw_watching_all{false};
+    changes fw_changes;
+};
+
+#endif
@@ -47,18 +47,30 @@ line_filter_observer::logline_new_lines(const logfile& lf,
         return;
     }
 
+    // The literals required by all of the filters are found in one pass over
+    // the line and only the filters that might match have to run their regex.
+    const auto& prefilter = this->lfo_filter_stack.get_prefilter();
+
     for (; ll_begin != ll_end; ++ll_begin) {
         if (lf.get_format() != nullptr) {
             lf.get_format()->get_subline(*ll_begin, sbr);
         }
+        if (prefilter.get_literal_count() > 0) {
+            prefilter.scan(sbr.to_string_fragment(), this->lfo_candidates);
+        } else {
+            this->lfo_candidates.assign(prefilter.get_group_count(), true);
+        }
         for (auto& filter : this->lfo_filter_stack) {
             if (filter->lf_deleted) {
                 continue;
             }
-            if (offset
-                >= this->lfo_filter_state.tfs_filter_count[filter->get_index()])
-            {
-                filter->add_line(this->lfo_filter_state, ll_begin, sbr);
+
+            auto index = filter->get_index();
+            if (offset >= this->lfo_filter_state.get_filter_count(index)) {
+                filter->add_line(this->lfo_filter_state,
+                                 ll_begin,
+                                 sbr,
+                                 this->lfo_candidates[index]);
             }
         }
     }
@@ -86,7 +98,7 @@ line_filter_observer::get_min_count(size_t max) const
         }
         retval = std::min(
             retval,
-            this->lfo_filter_state.tfs_filter_count[filter->get_index()]);
+            this->lfo_filter_state.get_filter_count(filter->get_index()));
     }
 
     return retval;
@@ -95,7 +107,7 @@ line_filter_observer::get_min_count(size_t max) const
 void
 line_filter_observer::clear_deleted_filter_state()
 {
-    uint32_t used_mask = 0;
+    filter_mask used_mask;
 
     for (auto& filter : this->lfo_filter_stack) {
         if (filter->lf_deleted) {
@@ -105,7 +117,7 @@ line_filter_observer::clear_deleted_filter_state()
                       filter->get_lang());
             continue;
         }
-        used_mask |= (1UL << filter->get_index());
+        used_mask.set(filter->get_index());
     }
     this->lfo_filter_state.clear_deleted_filter_state(used_mask);
 }
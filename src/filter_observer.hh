@@ -56,15 +56,12 @@ public:
 
     void logline_eof(const logfile& lf) override;
 
-    bool excluded(uint32_t filter_in_mask,
-                  uint32_t filter_out_mask,
+    bool excluded(const filter_mask& filter_in_mask,
+                  const filter_mask& filter_out_mask,
                   size_t offset) const
     {
-        bool filtered_in = (filter_in_mask == 0)
-            || (this->lfo_filter_state.tfs_mask[offset] & filter_in_mask) != 0;
-        bool filtered_out
-            = (this->lfo_filter_state.tfs_mask[offset] & filter_out_mask) != 0;
-        return !filtered_in || filtered_out;
+        return this->lfo_filter_state.excluded(
+            filter_in_mask, filter_out_mask, offset);
     }
 
     size_t get_min_count(size_t max) const;
@@ -73,6 +70,8 @@ public:
 
     filter_stack& lfo_filter_stack;
     logfile_filter_state lfo_filter_state;
+    /** The filters that might match the current line. */
+    std::vector<bool> lfo_candidates;
 };
 
 #endif
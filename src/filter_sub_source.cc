@@ -150,15 +150,8 @@ filter_sub_source::list_input_handle_key(listview_curses& lv, int ch)
             text_sub_source* tss = top_view->get_sub_source();
             filter_stack& fs = tss->get_filters();
             auto filter_index = fs.next_index();
-
-            if (!filter_index) {
-                lnav_data.ld_filter_help_status_source.fss_error.set_value(
-                    "error: too many filters");
-                return true;
-            }
-
             auto ef = std::make_shared<empty_filter>(
-                text_filter::type_t::INCLUDE, *filter_index);
+                text_filter::type_t::INCLUDE, filter_index);
             fs.add_filter(ef);
             lv.set_selection(vis_line_t(fs.size() - 1));
             lv.reload_data();
@@ -186,15 +179,8 @@ filter_sub_source::list_input_handle_key(listview_curses& lv, int ch)
             auto* tss = top_view->get_sub_source();
             auto& fs = tss->get_filters();
             auto filter_index = fs.next_index();
-
-            if (!filter_index) {
-                lnav_data.ld_filter_help_status_source.fss_error.set_value(
-                    "error: too many filters");
-                return true;
-            }
-
             auto ef = std::make_shared<empty_filter>(
-                text_filter::type_t::EXCLUDE, *filter_index);
+                text_filter::type_t::EXCLUDE, filter_index);
             fs.add_filter(ef);
             lv.set_selection(vis_line_t(fs.size() - 1));
             lv.reload_data();
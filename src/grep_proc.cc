@@ -39,6 +39,9 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "base/auto_pid.hh"
 #include "base/lnav_log.hh"
 #include "base/opt_util.hh"
@@ -47,13 +50,28 @@
 #include "lnav_util.hh"
 #include "vis_line.hh"
 
+/**
+ * The number of lines in a batch that are given to each search thread.  The
+ * batches are kept small so the lines are still in the cache when they are
+ * matched.
+ */
+static constexpr size_t LINES_PER_PARTITION = 2000;
+
 template<typename LineType>
 grep_proc<LineType>::grep_proc(std::shared_ptr<lnav::pcre2pp::code> code,
                                grep_proc_source<LineType>& gps,
-                               std::shared_ptr<pollable_supervisor> ps)
+                               std::shared_ptr<pollable_supervisor> ps,
+                               const grep_proc_ns::config& cfg)
     : pollable(ps, pollable::category::background), gp_pcre(code),
-      gp_source(gps)
+      gp_literals(code->get_required_folded_literals()), gp_source(gps),
+      gp_thread_count(cfg.c_threads),
+      gp_use_child_process(cfg.c_use_child_process)
 {
+    if (this->gp_thread_count == 0) {
+        this->gp_thread_count
+            = std::max(1U, std::thread::hardware_concurrency());
+    }
+
     require(this->invariant());
 
     gps.register_proc(this);
@@ -92,6 +110,11 @@ grep_proc<LineType>::start()
 {
     require(this->invariant());
 
+    if (!this->gp_use_child_process) {
+        this->thread_start();
+        return;
+    }
+
     if (this->gp_sink) {
         // XXX hack to make sure threads used by line_buffer are not active
         // before the fork.
@@ -104,6 +127,8 @@ grep_proc<LineType>::start()
         return;
     }
 
+    this->gp_source.grep_literals(this->gp_literals);
+
     auto_pipe in_pipe(STDIN_FILENO);
     auto_pipe out_pipe(STDOUT_FILENO);
     auto_pipe err_pipe(STDERR_FILENO);
@@ -186,6 +211,10 @@ grep_proc<LineType>::child_loop()
              line != -1 && (stop_line == -1 || line < stop_line) && !done;
              this->gp_source.grep_next_line(line))
         {
+            if (!this->gp_source.grep_line_might_match(line)) {
+                continue;
+            }
+
             line_value.clear();
             done = !this->gp_source.grep_value_for_line(line, line_value);
             if (!done) {
@@ -232,10 +261,259 @@ grep_proc<LineType>::child_loop()
     }
 }
 
+template<typename LineType>
+void
+grep_proc<LineType>::thread_start()
+{
+    log_debug("grep_proc(%p): start", this);
+    if (this->gp_searching || this->gp_queue.empty()) {
+        log_debug("grep_proc(%p): nothing to do?", this);
+        return;
+    }
+
+    if (this->gp_wakeup_pipe.read_end().get() == -1) {
+        if (this->gp_wakeup_pipe.open() < 0) {
+            throw error(errno);
+        }
+        for (auto& fd : {this->gp_wakeup_pipe.read_end().get(),
+                         this->gp_wakeup_pipe.write_end().get()})
+        {
+            log_perror(fcntl(fd, F_SETFL, O_NONBLOCK));
+            log_perror(fcntl(fd, F_SETFD, FD_CLOEXEC));
+        }
+    }
+
+    this->gp_source.grep_literals(this->gp_literals);
+    this->gp_searching = true;
+    this->gp_child_queue_size = this->gp_queue.size();
+    this->gp_thread_queue = std::move(this->gp_queue);
+    this->gp_queue.clear();
+    this->gp_thread_request_started = false;
+
+    // The lines are read in check_poll_set(), so wake up the poll loop.
+    log_perror(write(this->gp_wakeup_pipe.write_end(), "", 1));
+
+    log_debug("grep_proc(%p): started search with %zu threads",
+              this,
+              this->gp_thread_count);
+}
+
+template<typename LineType>
+void
+grep_proc<LineType>::thread_fetch(thread_batch& tb)
+{
+    auto batch_size = this->gp_thread_count * LINES_PER_PARTITION;
+    // Lines that are skipped still count a little so that a batch is
+    // returned every so often when most of them are ruled out.
+    auto skip_limit = batch_size * 64;
+    size_t skipped = 0;
+
+    tb.tb_count = 0;
+    while (!this->gp_thread_queue.empty() && tb.tb_count < batch_size
+           && skipped < skip_limit)
+    {
+        auto start_line = this->gp_thread_queue.front().first;
+        auto stop_line = this->gp_thread_queue.front().second;
+        auto& line = this->gp_thread_line;
+
+        if (!this->gp_thread_request_started) {
+            line = this->gp_source.grep_initial_line(start_line,
+                                                     this->gp_highest_line);
+            this->gp_thread_request_started = true;
+        }
+
+        auto done = line == -1 || (stop_line != -1 && line >= stop_line);
+        if (!done && !this->gp_source.grep_line_might_match(line)) {
+            this->gp_source.grep_next_line(line);
+            skipped += 1;
+            continue;
+        }
+        if (!done) {
+            if (tb.tb_count == tb.tb_values.size()) {
+                tb.tb_lines.emplace_back();
+                tb.tb_values.emplace_back();
+            }
+
+            auto& value = tb.tb_values[tb.tb_count];
+
+            value.clear();
+            if (this->gp_source.grep_value_for_line(line, value)) {
+                tb.tb_lines[tb.tb_count] = line;
+                tb.tb_count += 1;
+            } else {
+                done = true;
+            }
+            this->gp_source.grep_next_line(line);
+        }
+
+        if (done) {
+            if (stop_line == -1) {
+                // Remember the highest line that was seen so that the next
+                // request that continues from the end works properly.
+                this->gp_highest_line = line - 1_vl;
+            }
+            this->gp_thread_queue.pop_front();
+            this->gp_thread_request_started = false;
+        }
+    }
+}
+
+template<typename LineType>
+void
+grep_proc<LineType>::thread_match_range(thread_batch& tb,
+                                        size_t partition,
+                                        size_t begin,
+                                        size_t end) const
+{
+    auto& matches = tb.tb_matches[partition];
+
+    matches.clear();
+    for (auto lpc = begin; lpc < end; lpc++) {
+        const auto& value = tb.tb_values[lpc];
+
+        this->gp_pcre->capture_from(value).for_each(
+            [&](lnav::pcre2pp::match_data& md) {
+                thread_match tm;
+
+                tm.tm_line = tb.tb_lines[lpc];
+                tm.tm_begin = md[0]->sf_begin;
+                tm.tm_end = md[0]->sf_end;
+                for (int cap = 1; cap < md.get_count(); cap++) {
+                    if (!md[cap]) {
+                        continue;
+                    }
+                    tm.tm_captures.emplace_back(typename thread_match::capture{
+                        md[cap]->sf_begin,
+                        md[cap]->sf_end,
+                        md[cap]->to_string(),
+                    });
+                }
+                matches.emplace_back(std::move(tm));
+            });
+    }
+}
+
+template<typename LineType>
+void
+grep_proc<LineType>::thread_launch()
+{
+    auto& tb = this->gp_running_batch;
+    auto partitions = std::max(
+        (size_t) 1,
+        std::min(this->gp_thread_count, tb.tb_count / LINES_PER_PARTITION));
+    auto wakeup_fd = this->gp_wakeup_pipe.write_end().get();
+
+    tb.tb_matches.resize(partitions);
+    this->gp_batch_future = std::async(
+        std::launch::async, [this, &tb, partitions, wakeup_fd]() {
+            auto per_partition = (tb.tb_count + partitions - 1) / partitions;
+            auto range_for = [&tb, per_partition](size_t partition) {
+                auto begin = std::min(tb.tb_count, partition * per_partition);
+
+                return std::make_pair(
+                    begin, std::min(tb.tb_count, begin + per_partition));
+            };
+            std::vector<std::future<void>> workers;
+
+            for (size_t lpc = 1; lpc < partitions; lpc++) {
+                auto range = range_for(lpc);
+
+                workers.emplace_back(std::async(
+                    std::launch::async,
+                    &grep_proc<LineType>::thread_match_range,
+                    this,
+                    std::ref(tb),
+                    lpc,
+                    range.first,
+                    range.second));
+            }
+            auto range = range_for(0);
+            this->thread_match_range(tb, 0, range.first, range.second);
+            for (auto& worker : workers) {
+                worker.get();
+            }
+
+            log_perror(write(wakeup_fd, "", 1));
+        });
+}
+
+template<typename LineType>
+void
+grep_proc<LineType>::thread_dispatch(thread_batch& tb)
+{
+    if (this->gp_sink == nullptr) {
+        return;
+    }
+
+    for (auto& matches : tb.tb_matches) {
+        for (auto& tm : matches) {
+            this->gp_last_line = tm.tm_line;
+            this->gp_sink->grep_match(
+                *this, tm.tm_line, tm.tm_begin, tm.tm_end);
+            for (auto& cap : tm.tm_captures) {
+                this->gp_sink->grep_capture(*this,
+                                            tm.tm_line,
+                                            cap.c_begin,
+                                            cap.c_end,
+                                            &cap.c_value[0]);
+            }
+            this->gp_sink->grep_match_end(*this, tm.tm_line);
+        }
+        matches.clear();
+    }
+}
+
+template<typename LineType>
+void
+grep_proc<LineType>::thread_step()
+{
+    if (this->gp_batch_future.valid()) {
+        // The wakeup is the last thing written by the batch, so this should
+        // not have to wait for long.
+        this->gp_batch_future.get();
+        this->thread_dispatch(this->gp_running_batch);
+        if (this->gp_sink != nullptr) {
+            this->gp_sink->grep_end_batch(*this);
+        }
+    } else {
+        this->thread_fetch(this->gp_next_batch);
+    }
+
+    // A batch can be empty when all of its lines were ruled out, so only
+    // stop once the queue has been drained.
+    if (this->gp_next_batch.tb_count == 0 && this->gp_thread_queue.empty()) {
+        this->cleanup();
+        return;
+    }
+
+    // Match the lines that were already read and read the next batch while
+    // the threads are busy.
+    std::swap(this->gp_running_batch, this->gp_next_batch);
+    this->thread_launch();
+    this->thread_fetch(this->gp_next_batch);
+}
+
 template<typename LineType>
 void
 grep_proc<LineType>::cleanup()
 {
+    if (this->gp_batch_future.valid()) {
+        this->gp_batch_future.wait();
+        this->gp_batch_future = {};
+    }
+    if (this->gp_searching) {
+        this->gp_searching = false;
+        this->gp_thread_queue.clear();
+        this->gp_running_batch.tb_count = 0;
+        this->gp_next_batch.tb_count = 0;
+
+        if (this->gp_sink) {
+            for (size_t lpc = 0; lpc < this->gp_child_queue_size; lpc++) {
+                this->gp_sink->grep_end(*this);
+            }
+        }
+    }
+
     if (this->gp_child != -1 && this->gp_child != 0) {
         int status = 0;
 
@@ -316,6 +594,18 @@ grep_proc<LineType>::check_poll_set(const std::vector<struct pollfd>& pollfds)
 {
     require(this->invariant());
 
+    if (this->gp_searching
+        && pollfd_ready(pollfds, this->gp_wakeup_pipe.read_end()))
+    {
+        char buffer[32];
+
+        while (read(this->gp_wakeup_pipe.read_end(), buffer, sizeof(buffer))
+               > 0)
+        {
+        }
+        this->thread_step();
+    }
+
     if (this->gp_err_pipe != -1 && pollfd_ready(pollfds, this->gp_err_pipe)) {
         char buffer[1024 + 1];
         ssize_t rc;
@@ -421,6 +711,10 @@ grep_proc<LineType>::update_poll_set(std::vector<struct pollfd>& pollfds)
     if (this->gp_err_pipe.get() != -1) {
         pollfds.push_back((struct pollfd){this->gp_err_pipe, POLLIN, 0});
     }
+    if (this->gp_searching) {
+        pollfds.push_back(
+            (struct pollfd){this->gp_wakeup_pipe.read_end(), POLLIN, 0});
+    }
 }
 
 template class grep_proc<vis_line_t>;
@@ -34,6 +34,7 @@
 
 #include <deque>
 #include <exception>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,7 @@
 #include "base/auto_fd.hh"
 #include "base/auto_mem.hh"
 #include "base/lnav_log.hh"
+#include "grep_proc.cfg.hh"
 #include "line_buffer.hh"
 #include "pcrepp/pcre2pp.hh"
 #include "pollable.hh"
@@ -84,6 +86,23 @@ public:
 
     virtual void grep_next_line(LineType& line) { line = line + LineType(1); }
 
+    /**
+     * Called before a search is started with the literals that a line must
+     * contain to match the pattern.
+     *
+     * @param folded_literals The literals, folded to lowercase.
+     */
+    virtual void grep_literals(const std::vector<std::string>& folded_literals)
+    {
+    }
+
+    /**
+     * @param line The line to check.
+     * @return False if the line is known to not contain the literals passed
+     *   to grep_literals().
+     */
+    virtual bool grep_line_might_match(LineType line) { return true; }
+
     grep_proc<LineType>* gps_proc;
 };
 
@@ -154,11 +173,12 @@ public:
 };
 
 /**
- * "Grep" that runs in a separate process so it doesn't stall user-interaction.
- * This class manages the child process and any interactions between the parent
- * and child.  The source data to be matched comes from the grep_proc_source
- * delegate and the results are sent to the grep_proc_sink delegate in the
- * parent process.
+ * "Grep" that runs in the background so it doesn't stall user-interaction.
+ * By default, the lines are read from the grep_proc_source delegate in
+ * batches on the main thread and matched by a pool of threads.  The results
+ * of each batch are then sent to the grep_proc_sink delegate in line order.
+ * Alternatively, the search can be done by a forked child process that
+ * streams its results back over a pipe.
  *
  * Note: The "grep" executable is not actually used, instead we use the pcre(3)
  * library directly.
@@ -182,11 +202,11 @@ public:
      */
     grep_proc(std::shared_ptr<lnav::pcre2pp::code> code,
               grep_proc_source<LineType>& gps,
-              std::shared_ptr<pollable_supervisor> ps);
-
-    grep_proc(std::shared_ptr<pollable_supervisor>);
+              std::shared_ptr<pollable_supervisor> ps,
+              const grep_proc_ns::config& cfg = grep_proc_ns::config{});
 
-    using injectable = grep_proc(std::shared_ptr<pollable_supervisor>);
+    using injectable = grep_proc(std::shared_ptr<pollable_supervisor>,
+                                 const grep_proc_ns::config&);
 
     virtual ~grep_proc();
 
@@ -201,6 +221,19 @@ public:
     /** @return The sink to send results to. */
     grep_proc_sink<LineType>* get_sink() { return this->gp_sink; }
 
+    /**
+     * Set the highest line that has been searched.  This is used when the
+     * lines have been renumbered without needing to be searched again, so
+     * that a later request starting at -1 continues from the right place.
+     *
+     * @param line The new highest line.
+     */
+    grep_proc& set_highest_line(LineType line)
+    {
+        this->gp_highest_line = line;
+        return *this;
+    }
+
     /**
      * Queue a request to search the input between the given line numbers.
      *
@@ -239,6 +272,9 @@ public:
     /** Check the invariants for this object. */
     bool invariant()
     {
+        if (this->gp_searching) {
+            require(!this->gp_child_started);
+        }
         if (this->gp_child_started) {
             require(this->gp_child > 0);
             require(this->gp_line_buffer.get_fd() != -1);
@@ -265,6 +301,51 @@ protected:
 
     void child_loop();
 
+    /** A match found by one of the search threads. */
+    struct thread_match {
+        struct capture {
+            int c_begin;
+            int c_end;
+            std::string c_value;
+        };
+
+        LineType tm_line;
+        int tm_begin;
+        int tm_end;
+        std::vector<capture> tm_captures;
+    };
+
+    /** A batch of line values to be matched by the search threads. */
+    struct thread_batch {
+        std::vector<LineType> tb_lines;
+        std::vector<std::string> tb_values;
+        size_t tb_count{0};
+        /** The matches for each partition of the batch, in line order. */
+        std::vector<std::vector<thread_match>> tb_matches;
+    };
+
+    void thread_start();
+
+    /**
+     * Read the next batch of line values from the source for the queued
+     * requests.
+     */
+    void thread_fetch(thread_batch& tb);
+
+    /** Start matching a batch on the search threads. */
+    void thread_launch();
+
+    void thread_match_range(thread_batch& tb,
+                            size_t partition,
+                            size_t begin,
+                            size_t end) const;
+
+    /** Send the matches for a batch to the sink. */
+    void thread_dispatch(thread_batch& tb);
+
+    /** Continue a search after the current batch has been matched. */
+    void thread_step();
+
     virtual void child_init(){};
 
     virtual void child_batch() { fflush(stdout); }
@@ -275,6 +356,8 @@ protected:
         int line, std::string& line_value, int off, int* matches, int count);
 
     std::shared_ptr<lnav::pcre2pp::code> gp_pcre;
+    /** The literals that a line must contain to match the pattern. */
+    std::vector<std::string> gp_literals;
     grep_proc_source<LineType>& gp_source; /*< The data source delegate. */
 
     auto_fd gp_err_pipe; /*< Standard error from the child. */
@@ -302,6 +385,19 @@ protected:
                                */
     grep_proc_sink<LineType>* gp_sink{nullptr}; /*< The sink delegate. */
     grep_proc_control* gp_control{nullptr}; /*< The control delegate. */
+
+    size_t gp_thread_count;
+    bool gp_use_child_process;
+    bool gp_searching{false}; /*< True if the search threads are active. */
+    /** The requests being processed by the search threads. */
+    std::deque<std::pair<LineType, LineType> > gp_thread_queue;
+    bool gp_thread_request_started{false};
+    LineType gp_thread_line{0};
+    thread_batch gp_running_batch;
+    thread_batch gp_next_batch;
+    std::future<void> gp_batch_future;
+    /** Written to by the search threads when a batch has been matched. */
+    auto_pipe gp_wakeup_pipe;
 };
 
 #endif
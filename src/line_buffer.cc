@@ -43,6 +43,7 @@
 
 #include <algorithm>
 #include <set>
+#include <thread>
 
 #ifdef HAVE_X86INTRIN_H
 #    include "simdutf8check.h"
@@ -145,13 +146,117 @@ line_buffer::gz_indexed::close()
 {
     // Release old stream, if we were open
     if (*this) {
+        this->save_index();
         inflateEnd(&this->strm);
         ::close(this->gz_fd);
         this->syncpoints.clear();
         this->gz_fd = -1;
+        this->gz_index_path = nonstd::nullopt;
+        this->gz_saved_syncpoints = 0;
     }
 }
 
+static const char GZ_INDEX_MAGIC[8] = {'l', 'n', 'a', 'v', 'g', 'z', 'i', 0};
+
+struct gz_index_header {
+    char gih_magic[8];
+    uint32_t gih_dict_size;
+    uint32_t gih_count;
+    int64_t gih_size;
+    int64_t gih_mtime;
+};
+
+void
+line_buffer::gz_indexed::load_index(const ghc::filesystem::path& path,
+                                    const struct stat& st)
+{
+    this->gz_index_path = path;
+    this->gz_index_stat = st;
+
+    auto open_res = lnav::filesystem::open_file(path, O_RDONLY);
+    if (open_res.isErr()) {
+        return;
+    }
+
+    auto index_fd = open_res.unwrap();
+    gz_index_header gih;
+
+    if (::read(index_fd, &gih, sizeof(gih)) != sizeof(gih)
+        || memcmp(gih.gih_magic, GZ_INDEX_MAGIC, sizeof(gih.gih_magic)) != 0
+        || gih.gih_dict_size != sizeof(indexDict) || gih.gih_size != st.st_size
+        || gih.gih_mtime != st.st_mtime)
+    {
+        log_info("%d: ignoring stale gzip index -- %s",
+                 this->gz_fd,
+                 path.c_str());
+        return;
+    }
+
+    std::vector<indexDict> loaded(gih.gih_count);
+    auto bytes = loaded.size() * sizeof(indexDict);
+    if (pread(index_fd, loaded.data(), bytes, sizeof(gih)) != (ssize_t) bytes)
+    {
+        log_error("%d: truncated gzip index -- %s", this->gz_fd, path.c_str());
+        return;
+    }
+
+    this->syncpoints = std::move(loaded);
+    this->gz_saved_syncpoints = this->syncpoints.size();
+    log_info("%d: loaded %d gzip syncpoints -- %s",
+             this->gz_fd,
+             this->syncpoints.size(),
+             path.c_str());
+}
+
+void
+line_buffer::gz_indexed::save_index()
+{
+    if (!this->gz_index_path
+        || this->syncpoints.size() <= this->gz_saved_syncpoints)
+    {
+        return;
+    }
+
+    auto& path = this->gz_index_path.value();
+    auto tmp_path = path;
+    tmp_path += fmt::format(FMT_STRING(".{}.tmp"), getpid());
+    std::error_code ec;
+
+    ghc::filesystem::create_directories(path.parent_path(), ec);
+    auto create_res = lnav::filesystem::create_file(
+        tmp_path, O_WRONLY | O_TRUNC, 0600);
+    if (create_res.isErr()) {
+        log_error("unable to create gzip index: %s -- %s",
+                  tmp_path.c_str(),
+                  create_res.unwrapErr().c_str());
+        return;
+    }
+
+    auto index_fd = create_res.unwrap();
+    gz_index_header gih;
+
+    memcpy(gih.gih_magic, GZ_INDEX_MAGIC, sizeof(gih.gih_magic));
+    gih.gih_dict_size = sizeof(indexDict);
+    gih.gih_count = this->syncpoints.size();
+    gih.gih_size = this->gz_index_stat.st_size;
+    gih.gih_mtime = this->gz_index_stat.st_mtime;
+
+    auto bytes = this->syncpoints.size() * sizeof(indexDict);
+    if (write(index_fd, &gih, sizeof(gih)) != sizeof(gih)
+        || write(index_fd, this->syncpoints.data(), bytes) != (ssize_t) bytes)
+    {
+        log_error("unable to write gzip index: %s", tmp_path.c_str());
+        ghc::filesystem::remove(tmp_path, ec);
+        return;
+    }
+
+    ghc::filesystem::rename(tmp_path, path, ec);
+    log_info("%d: saved %d gzip syncpoints -- %s",
+             this->gz_fd,
+             this->syncpoints.size(),
+             path.c_str());
+}
+
 void
 line_buffer::gz_indexed::init_stream()
 {
@@ -349,9 +454,129 @@ line_buffer::gz_indexed::seek(off_t offset)
     }
 }
 
+int
+line_buffer::gz_indexed::read_region(indexDict& dict,
+                                     void* buf,
+                                     size_t size) const
+{
+    z_stream rstrm;
+    auto_mem<Bytef> rinbuf;
+
+    if ((rinbuf = (Bytef*) malloc(Z_BUFSIZE)) == nullptr) {
+        return -1;
+    }
+    if (dict.apply(&rstrm) != Z_OK) {
+        return -1;
+    }
+
+    rstrm.next_out = (unsigned char*) buf;
+    rstrm.avail_out = size;
+    while (rstrm.avail_out) {
+        if (!rstrm.avail_in) {
+            auto rc = ::pread(
+                this->gz_fd, rinbuf.in(), Z_BUFSIZE, rstrm.total_in);
+            if (rc <= 0) {
+                break;
+            }
+            rstrm.next_in = rinbuf.in();
+            rstrm.avail_in = rc;
+        }
+
+        auto err = inflate(&rstrm, Z_NO_FLUSH);
+        if (err == Z_STREAM_END) {
+            // Start on the next member of the file, like continue_stream().
+            auto total_in = rstrm.total_in;
+            auto total_out = rstrm.total_out;
+            auto avail_out = rstrm.avail_out;
+            auto next_out = rstrm.next_out;
+
+            inflateEnd(&rstrm);
+            rstrm.zalloc = Z_NULL;
+            rstrm.zfree = Z_NULL;
+            rstrm.opaque = Z_NULL;
+            rstrm.avail_in = 0;
+            rstrm.next_in = Z_NULL;
+            if (inflateInit2(&rstrm, GZ_HEADER_MODE) != Z_OK) {
+                return -1;
+            }
+            rstrm.total_in = total_in;
+            rstrm.total_out = total_out;
+            rstrm.avail_out = avail_out;
+            rstrm.next_out = next_out;
+        } else if (err != Z_OK) {
+            log_error(" region inflate-error: %d  %s",
+                      (int) err,
+                      rstrm.msg ? rstrm.msg : "");
+            break;
+        }
+    }
+    inflateEnd(&rstrm);
+
+    return size - rstrm.avail_out;
+}
+
 int
 line_buffer::gz_indexed::read(void* buf, size_t offset, size_t size)
 {
+    auto end_offset = offset + size;
+    auto first_sp = std::upper_bound(
+        this->syncpoints.begin(),
+        this->syncpoints.end(),
+        offset,
+        [](size_t off, const indexDict& d) { return off < (size_t) d.out; });
+    auto last_sp = std::lower_bound(
+        first_sp,
+        this->syncpoints.end(),
+        end_offset,
+        [](const indexDict& d, size_t off) { return (size_t) d.out < off; });
+
+    if (first_sp != last_sp) {
+        // The read spans syncpoints that were already discovered, so the
+        // regions between them can be inflated independently.
+        std::vector<std::future<int>> regions;
+        std::vector<size_t> region_sizes;
+
+        for (auto iter = first_sp; iter != last_sp; ++iter) {
+            auto next_iter = std::next(iter);
+            auto region_end = next_iter == last_sp
+                ? end_offset
+                : std::min(end_offset, (size_t) next_iter->out);
+            auto region_size = region_end - iter->out;
+            auto* region_buf = (unsigned char*) buf + (iter->out - offset);
+
+            region_sizes.emplace_back(region_size);
+            regions.emplace_back(std::async(
+                std::launch::async,
+                [this, dict = *iter, region_buf, region_size]() mutable {
+                    return this->read_region(dict, region_buf, region_size);
+                }));
+        }
+
+        int retval = 0;
+        if (offset < (size_t) first_sp->out) {
+            if (offset != this->strm.total_out) {
+                this->seek(offset);
+            }
+            retval = stream_data(buf, first_sp->out - offset);
+        }
+
+        auto short_read = retval < (int) (first_sp->out - offset);
+        for (size_t lpc = 0; lpc < regions.size(); lpc++) {
+            auto rc = regions[lpc].get();
+
+            if (short_read || rc < 0) {
+                short_read = true;
+                continue;
+            }
+            retval += rc;
+            if ((size_t) rc < region_sizes[lpc]) {
+                short_read = true;
+            }
+        }
+
+        return retval;
+    }
+
     if (offset != this->strm.total_out) {
         // log_debug("doing seek!  %d %d", offset, this->strm.total_out);
         this->seek(offset);
@@ -362,6 +587,445 @@ line_buffer::gz_indexed::read(void* buf, size_t offset, size_t size)
     return bytes;
 }
 
+#ifdef HAVE_BZLIB_H
+static const uint64_t BZ_BLOCK_MAGIC = 0x314159265359ULL;
+static const uint64_t BZ_EOS_MAGIC = 0x177245385090ULL;
+static const uint64_t BZ_MAGIC_MASK = 0xffffffffffffULL;
+static const size_t BZ_SCAN_SIZE = 1024 * 1024;
+
+namespace {
+
+class bit_writer {
+public:
+    void put_bits(uint32_t value, int count)
+    {
+        this->bw_acc = (this->bw_acc << count) | (value & ((1ULL << count) - 1));
+        this->bw_count += count;
+        while (this->bw_count >= 8) {
+            this->bw_count -= 8;
+            this->bw_out.push_back((char) (this->bw_acc >> this->bw_count));
+        }
+    }
+
+    std::vector<char>& finish()
+    {
+        if (this->bw_count > 0) {
+            this->put_bits(0, 8 - this->bw_count);
+        }
+        return this->bw_out;
+    }
+
+private:
+    uint64_t bw_acc{0};
+    int bw_count{0};
+    std::vector<char> bw_out;
+};
+
+}  // namespace
+
+void
+line_buffer::bz_indexed::open(int fd)
+{
+    this->close();
+    this->bz_fd = fd;
+}
+
+void
+line_buffer::bz_indexed::close()
+{
+    this->bz_fd = -1;
+    this->bz_blocks.clear();
+    this->bz_scan_bit_offset = 0;
+    this->bz_pending_start = nonstd::nullopt;
+    this->bz_scan_done = false;
+    this->bz_source_offset = 0;
+    this->bz_block_cache.clear();
+}
+
+bool
+line_buffer::bz_indexed::find_blocks(size_t count)
+{
+    std::vector<unsigned char> scan_buf(BZ_SCAN_SIZE);
+    file_off_t byte_off = this->bz_scan_bit_offset / 8;
+    uint64_t reg = 0;
+    uint64_t bits_loaded = 0;
+    size_t found = 0;
+
+    while (!this->bz_scan_done && found < count) {
+        auto rc = pread(this->bz_fd, scan_buf.data(), scan_buf.size(), byte_off);
+
+        if (rc < 0) {
+            return false;
+        }
+        if (rc == 0) {
+            this->bz_scan_done = true;
+            break;
+        }
+
+        ssize_t lpc = 0;
+        for (; lpc < rc && found < count; lpc++) {
+            reg = (reg << 8) | scan_buf[lpc];
+            bits_loaded += 8;
+
+            // The magic numbers are not byte-aligned, so check each bit
+            // position that ends in this byte.
+            uint64_t next_bit = (byte_off + lpc + 1) * 8;
+            for (int shift = 7; shift >= 0; shift--) {
+                if (bits_loaded < 48 + (uint64_t) shift) {
+                    continue;
+                }
+
+                auto value = (reg >> shift) & BZ_MAGIC_MASK;
+                if (value != BZ_BLOCK_MAGIC && value != BZ_EOS_MAGIC) {
+                    continue;
+                }
+
+                auto magic_start = next_bit - shift - 48;
+                if (magic_start < this->bz_scan_bit_offset) {
+                    continue;
+                }
+
+                if (this->bz_pending_start) {
+                    block blk;
+
+                    blk.b_bit_start = this->bz_pending_start.value();
+                    blk.b_bit_end = magic_start;
+                    this->bz_blocks.emplace_back(blk);
+                    found += 1;
+                }
+                if (value == BZ_BLOCK_MAGIC) {
+                    this->bz_pending_start = magic_start;
+                } else {
+                    this->bz_pending_start = nonstd::nullopt;
+                }
+                this->bz_scan_bit_offset = magic_start + 48;
+            }
+        }
+        byte_off += lpc;
+    }
+
+    return true;
+}
+
+line_buffer::bz_indexed::block_data
+line_buffer::bz_indexed::decompress_block(const block& blk) const
+{
+    auto first_byte = blk.b_bit_start / 8;
+    auto last_byte = (blk.b_bit_end + 7) / 8;
+    std::vector<unsigned char> src(last_byte - first_byte + 1, 0);
+
+    auto rc = pread(this->bz_fd, src.data(), last_byte - first_byte, first_byte);
+    if (rc != (ssize_t) (last_byte - first_byte)) {
+        return nullptr;
+    }
+
+    auto bit_shift = blk.b_bit_start % 8;
+    auto get_bits = [&src, bit_shift](uint64_t bit_off, int count) {
+        uint32_t retval = 0;
+
+        for (int lpc = 0; lpc < count; lpc++) {
+            auto abs_bit = bit_off + bit_shift + lpc;
+            auto bit = (src[abs_bit / 8] >> (7 - (abs_bit % 8))) & 1;
+
+            retval = (retval << 1) | bit;
+        }
+        return retval;
+    };
+
+    // Repackage the block as a complete stream with a single block.  The
+    // combined CRC of a single-block stream is just the block's CRC.
+    bit_writer bw;
+    auto block_bits = blk.b_bit_end - blk.b_bit_start;
+    auto block_crc = (get_bits(48, 16) << 16) | get_bits(64, 16);
+
+    for (auto ch : {'B', 'Z', 'h', '9'}) {
+        bw.put_bits(ch, 8);
+    }
+    uint64_t bit_off = 0;
+    for (; bit_off + 8 <= block_bits; bit_off += 8) {
+        auto abs_bit = bit_off + bit_shift;
+        auto byte_index = abs_bit / 8;
+        auto byte_shift = abs_bit % 8;
+        uint32_t value = (((uint32_t) src[byte_index] << 8)
+                          | src[byte_index + 1])
+            >> (8 - byte_shift);
+
+        bw.put_bits(value & 0xff, 8);
+    }
+    if (bit_off < block_bits) {
+        auto remaining = (int) (block_bits - bit_off);
+
+        bw.put_bits(get_bits(bit_off, remaining), remaining);
+    }
+    bw.put_bits(BZ_EOS_MAGIC >> 24, 24);
+    bw.put_bits(BZ_EOS_MAGIC & 0xffffff, 24);
+    bw.put_bits(block_crc, 32);
+
+    auto& stream = bw.finish();
+    auto retval = std::make_shared<std::vector<char>>();
+    bz_stream strm;
+
+    memset(&strm, 0, sizeof(strm));
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+        return nullptr;
+    }
+    strm.next_in = stream.data();
+    strm.avail_in = stream.size();
+    retval->resize(1024 * 1024);
+
+    int bzrc;
+    do {
+        if (strm.total_out_lo32 == retval->size()) {
+            retval->resize(retval->size() * 2);
+        }
+        strm.next_out = retval->data() + strm.total_out_lo32;
+        strm.avail_out = retval->size() - strm.total_out_lo32;
+        bzrc = BZ2_bzDecompress(&strm);
+    } while (bzrc == BZ_OK && strm.avail_out == 0);
+    retval->resize(strm.total_out_lo32);
+    BZ2_bzDecompressEnd(&strm);
+
+    if (bzrc != BZ_STREAM_END) {
+        log_error("%d: unable to decompress bzip2 block at bit %lld -- %d",
+                  this->bz_fd,
+                  blk.b_bit_start,
+                  bzrc);
+        return nullptr;
+    }
+
+    return retval;
+}
+
+bool
+line_buffer::bz_indexed::load_blocks(size_t first, size_t last)
+{
+    std::vector<std::pair<size_t, std::future<block_data>>> pending;
+
+    for (auto lpc = first; lpc < last; lpc++) {
+        if (this->bz_block_cache.count(lpc) > 0) {
+            continue;
+        }
+
+        auto blk = this->bz_blocks[lpc];
+        pending.emplace_back(lpc, std::async(std::launch::async, [this, blk]() {
+                                 return this->decompress_block(blk);
+                             }));
+    }
+
+    auto retval = true;
+    for (auto& pair : pending) {
+        auto data = pair.second.get();
+
+        if (data == nullptr) {
+            retval = false;
+            continue;
+        }
+        this->bz_block_cache[pair.first] = data;
+    }
+    if (!retval) {
+        return false;
+    }
+
+    for (auto lpc = first; lpc < last; lpc++) {
+        auto& blk = this->bz_blocks[lpc];
+
+        if (blk.b_out_size != -1) {
+            continue;
+        }
+        if (lpc > 0) {
+            const auto& prev = this->bz_blocks[lpc - 1];
+
+            if (prev.b_out_size == -1) {
+                break;
+            }
+            blk.b_out_offset = prev.b_out_offset + prev.b_out_size;
+        }
+        blk.b_out_size = this->bz_block_cache[lpc]->size();
+    }
+
+    return true;
+}
+
+int
+line_buffer::bz_indexed::read(void* buf, size_t offset, size_t size)
+{
+    size_t batch_size = std::max(2U, std::thread::hardware_concurrency());
+    auto end_offset = offset + size;
+
+    while (true) {
+        auto sized_end = std::find_if(
+            this->bz_blocks.begin(),
+            this->bz_blocks.end(),
+            [](const block& blk) { return blk.b_out_size == -1; });
+        size_t sized_count = std::distance(this->bz_blocks.begin(), sized_end);
+        size_t known_end = 0;
+
+        if (sized_count > 0) {
+            const auto& last_sized = this->bz_blocks[sized_count - 1];
+
+            known_end = last_sized.b_out_offset + last_sized.b_out_size;
+        }
+        if (known_end >= end_offset) {
+            break;
+        }
+
+        if (sized_count == this->bz_blocks.size()) {
+            if (this->bz_scan_done) {
+                break;
+            }
+            if (!this->find_blocks(batch_size)) {
+                return -1;
+            }
+            continue;
+        }
+
+        auto last = std::min(this->bz_blocks.size(), sized_count + batch_size);
+        if (!this->load_blocks(sized_count, last)) {
+            return -1;
+        }
+    }
+
+    auto first_iter = std::upper_bound(
+        this->bz_blocks.begin(),
+        this->bz_blocks.end(),
+        offset,
+        [](size_t off, const block& blk) {
+            return blk.b_out_size == -1 || off < (size_t) blk.b_out_offset;
+        });
+    if (first_iter == this->bz_blocks.begin()) {
+        return 0;
+    }
+    --first_iter;
+
+    size_t first_index = std::distance(this->bz_blocks.begin(), first_iter);
+    size_t last_index = first_index;
+    while (last_index < this->bz_blocks.size()
+           && this->bz_blocks[last_index].b_out_size != -1
+           && (size_t) this->bz_blocks[last_index].b_out_offset < end_offset)
+    {
+        last_index += 1;
+    }
+    if (!this->load_blocks(first_index, last_index)) {
+        return -1;
+    }
+
+    auto* dst = static_cast<char*>(buf);
+    size_t retval = 0;
+    for (auto lpc = first_index; lpc < last_index; lpc++) {
+        const auto& blk = this->bz_blocks[lpc];
+        const auto& data = *this->bz_block_cache[lpc];
+        auto copy_start = std::max(offset, (size_t) blk.b_out_offset)
+            - blk.b_out_offset;
+        auto copy_end = std::min(end_offset,
+                                 (size_t) (blk.b_out_offset + blk.b_out_size))
+            - blk.b_out_offset;
+
+        if (copy_start >= copy_end) {
+            continue;
+        }
+        memcpy(dst + retval, data.data() + copy_start, copy_end - copy_start);
+        retval += copy_end - copy_start;
+        this->bz_source_offset = blk.b_bit_end / 8;
+    }
+
+    // Only keep the blocks around the last read and any read-ahead.
+    for (auto iter = this->bz_block_cache.begin();
+         iter != this->bz_block_cache.end();)
+    {
+        if (iter->first + batch_size < first_index
+            || iter->first > last_index + batch_size)
+        {
+            iter = this->bz_block_cache.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    return retval;
+}
+
+ssize_t
+line_buffer::bz_read_from_start(char* buf, file_off_t offset, size_t size)
+{
+    lock_hack::guard guard;
+    char scratch[32 * 1024];
+    BZFILE* bz_file;
+    file_off_t seek_to;
+    int bzfd;
+    ssize_t rc;
+
+    /*
+     * Unfortunately, there is no bzseek, so we need to reopen the
+     * file every time we want to do a read.
+     */
+    bzfd = dup(this->lb_fd);
+    if (lseek(this->lb_fd, 0, SEEK_SET) < 0) {
+        close(bzfd);
+        throw error(errno);
+    }
+    if ((bz_file = BZ2_bzdopen(bzfd, "r")) == nullptr) {
+        close(bzfd);
+        if (errno == 0) {
+            throw std::bad_alloc();
+        } else {
+            throw error(errno);
+        }
+    }
+
+    seek_to = offset;
+    while (seek_to > 0) {
+        int count;
+
+        count = BZ2_bzread(
+            bz_file, scratch, std::min((size_t) seek_to, sizeof(scratch)));
+        seek_to -= count;
+    }
+    rc = BZ2_bzread(bz_file, buf, size);
+    this->lb_compressed_offset = lseek(bzfd, 0, SEEK_SET);
+    BZ2_bzclose(bz_file);
+
+    return rc;
+}
+
+ssize_t
+line_buffer::bz_read(char* buf, file_off_t offset, size_t size)
+{
+    if (this->lb_bz_index) {
+        auto rc = this->lb_bz_index.read(buf, offset, size);
+
+        if (rc != -1) {
+            this->lb_compressed_offset = this->lb_bz_index.get_source_offset();
+            return rc;
+        }
+
+        log_warning("%d: falling back to sequential bzip2 reads",
+                    this->lb_fd.get());
+        this->lb_bz_index.close();
+    }
+
+    return this->bz_read_from_start(buf, offset, size);
+}
+#endif
+
+static ghc::filesystem::path
+line_buffer_cache_path()
+{
+    return lnav::paths::workdir() / "buffer-cache";
+}
+
+static ghc::filesystem::path
+gz_index_path_for(const struct stat& st)
+{
+    auto base_name = hasher()
+                         .update(st.st_dev)
+                         .update(st.st_ino)
+                         .update(st.st_size)
+                         .to_string();
+
+    return line_buffer_cache_path() / base_name.substr(0, 2)
+        / fmt::format(FMT_STRING("{}.gzidx"), base_name);
+}
+
 line_buffer::line_buffer()
 {
     ensure(this->invariant());
@@ -391,6 +1055,9 @@ line_buffer::set_fd(auto_fd& fd)
 
     if (this->lb_bz_file) {
         this->lb_bz_file = false;
+#ifdef HAVE_BZLIB_H
+        this->lb_bz_index.close();
+#endif
     }
 
     if (fd != -1) {
@@ -416,7 +1083,16 @@ line_buffer::set_fd(auto_fd& fd)
                         close(gzfd);
                         throw error(errno);
                     }
-                    this->lb_gz_file.writeAccess()->open(gzfd, this->lb_header);
+                    {
+                        safe::WriteAccess<safe_gz_indexed> gi(
+                            this->lb_gz_file);
+                        struct stat st;
+
+                        gi->open(gzfd, this->lb_header);
+                        if (fstat(fd, &st) == 0) {
+                            gi->load_index(gz_index_path_for(st), st);
+                        }
+                    }
                     this->lb_compressed = true;
                     this->lb_file_time = this->lb_header.hd_mtime.tv_sec;
                     if (this->lb_file_time < 0) {
@@ -434,6 +1110,7 @@ line_buffer::set_fd(auto_fd& fd)
                     }
                     this->lb_bz_file = true;
                     this->lb_compressed = true;
+                    this->lb_bz_index.open(fd);
 
                     /*
                      * Loading data from a bzip2 file is pretty slow, so we try
@@ -593,44 +1270,9 @@ line_buffer::load_next_buffer()
         {
             rc = 0;
         } else {
-            lock_hack::guard guard;
-            char scratch[32 * 1024];
-            BZFILE* bz_file;
-            file_off_t seek_to;
-            int bzfd;
-
-            /*
-             * Unfortunately, there is no bzseek, so we need to reopen the
-             * file every time we want to do a read.
-             */
-            bzfd = dup(this->lb_fd);
-            if (lseek(this->lb_fd, 0, SEEK_SET) < 0) {
-                close(bzfd);
-                throw error(errno);
-            }
-            if ((bz_file = BZ2_bzdopen(bzfd, "r")) == nullptr) {
-                close(bzfd);
-                if (errno == 0) {
-                    throw std::bad_alloc();
-                } else {
-                    throw error(errno);
-                }
-            }
-
-            seek_to = start + this->lb_alt_buffer.value().size();
-            while (seek_to > 0) {
-                int count;
-
-                count = BZ2_bzread(bz_file,
-                                   scratch,
-                                   std::min((size_t) seek_to, sizeof(scratch)));
-                seek_to -= count;
-            }
-            rc = BZ2_bzread(bz_file,
-                            this->lb_alt_buffer->end(),
-                            this->lb_alt_buffer->available());
-            this->lb_compressed_offset = lseek(bzfd, 0, SEEK_SET);
-            BZ2_bzclose(bz_file);
+            rc = this->bz_read(this->lb_alt_buffer->end(),
+                               start + this->lb_alt_buffer.value().size(),
+                               this->lb_alt_buffer->available());
 
             if (rc != -1 && (rc < (this->lb_alt_buffer.value().available()))
                 && (start + this->lb_alt_buffer.value().size() + rc
@@ -869,45 +1511,10 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
             {
                 rc = 0;
             } else {
-                lock_hack::guard guard;
-                char scratch[32 * 1024];
-                BZFILE* bz_file;
-                file_off_t seek_to;
-                int bzfd;
-
-                /*
-                 * Unfortunately, there is no bzseek, so we need to reopen the
-                 * file every time we want to do a read.
-                 */
-                bzfd = dup(this->lb_fd);
-                if (lseek(this->lb_fd, 0, SEEK_SET) < 0) {
-                    close(bzfd);
-                    throw error(errno);
-                }
-                if ((bz_file = BZ2_bzdopen(bzfd, "r")) == NULL) {
-                    close(bzfd);
-                    if (errno == 0) {
-                        throw std::bad_alloc();
-                    } else {
-                        throw error(errno);
-                    }
-                }
-
-                seek_to = this->lb_file_offset + this->lb_buffer.size();
-                while (seek_to > 0) {
-                    int count;
-
-                    count = BZ2_bzread(
-                        bz_file,
-                        scratch,
-                        std::min((size_t) seek_to, sizeof(scratch)));
-                    seek_to -= count;
-                }
-                rc = BZ2_bzread(bz_file,
-                                this->lb_buffer.end(),
-                                this->lb_buffer.available());
-                this->lb_compressed_offset = lseek(bzfd, 0, SEEK_SET);
-                BZ2_bzclose(bz_file);
+                rc = this->bz_read(this->lb_buffer.end(),
+                                   this->lb_file_offset
+                                       + this->lb_buffer.size(),
+                                   this->lb_buffer.available());
 
                 if (rc != -1 && (rc < (this->lb_buffer.available()))) {
                     this->lb_file_size
@@ -1317,12 +1924,6 @@ line_buffer::quiesce()
     }
 }
 
-static ghc::filesystem::path
-line_buffer_cache_path()
-{
-    return lnav::paths::workdir() / "buffer-cache";
-}
-
 void
 line_buffer::enable_cache()
 {
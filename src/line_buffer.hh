@@ -35,9 +35,12 @@
 #include <array>
 #include <exception>
 #include <future>
+#include <map>
+#include <memory>
 #include <vector>
 
 #include <errno.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <zlib.h>
@@ -47,6 +50,8 @@
 #include "base/file_range.hh"
 #include "base/lnav_log.hh"
 #include "base/result.h"
+#include "ghc/filesystem.hpp"
+#include "optional.hpp"
 #include "safe/safe.h"
 #include "shared_buffer.hh"
 
@@ -127,23 +132,96 @@ public:
          */
         int read(void* buf, size_t offset, size_t size);
 
+        /**
+         * Load the syncpoints that were saved the last time this file was
+         * read.  The syncpoints will be written back to the given path when
+         * the file is closed if more were discovered.
+         *
+         * @param path The path of the syncpoint index file.
+         * @param st The stat() of the compressed file.
+         */
+        void load_index(const ghc::filesystem::path& path,
+                        const struct stat& st);
+
         struct indexDict {
             off_t in = 0;
             off_t out = 0;
             unsigned char bits = 0;
             unsigned char in_bits = 0;
             Bytef index[GZ_WINSIZE];
+            indexDict() = default;
             indexDict(z_stream const& s, const file_size_t size);
 
             int apply(z_streamp s);
         };
 
     private:
+        void save_index();
+
+        /**
+         * Decompress the region starting at the given syncpoint into the
+         * buffer using a separate stream so that several regions can be
+         * inflated in parallel.
+         */
+        int read_region(indexDict& dict, void* buf, size_t size) const;
+
         z_stream strm; /*< gzip streams structure */
         std::vector<indexDict>
             syncpoints; /*< indexed dictionaries as discovered */
         auto_mem<Bytef> inbuf; /*< Compressed data buffer */
         int gz_fd = -1; /*< The file to read data from. */
+        nonstd::optional<ghc::filesystem::path> gz_index_path;
+        struct stat gz_index_stat {};
+        size_t gz_saved_syncpoints{0};
+    };
+
+    /**
+     * A bzip2 file reader that can do random access by decompressing the
+     * blocks in the file independently.  The compressed file is scanned for
+     * the block headers, which are not byte-aligned, and each block is
+     * repackaged as a single-block stream that can be decompressed on its
+     * own.  Blocks are decompressed in parallel when a read spans more than
+     * one of them.
+     */
+    class bz_indexed {
+    public:
+        inline operator bool() const { return this->bz_fd != -1; }
+
+        void open(int fd);
+        void close();
+
+        file_off_t get_source_offset() const { return this->bz_source_offset; }
+
+        /**
+         * Decompress bytes from the bz2 file returning at most `size` bytes.
+         * offset is the byte-offset in the decompressed data stream.
+         *
+         * @return The number of bytes read or -1 if the blocks in the file
+         * could not be decompressed independently.
+         */
+        int read(void* buf, size_t offset, size_t size);
+
+    private:
+        struct block {
+            uint64_t b_bit_start{0};
+            uint64_t b_bit_end{0};
+            file_off_t b_out_offset{0};
+            file_ssize_t b_out_size{-1};
+        };
+
+        using block_data = std::shared_ptr<std::vector<char>>;
+
+        bool find_blocks(size_t count);
+        block_data decompress_block(const block& blk) const;
+        bool load_blocks(size_t first, size_t last);
+
+        int bz_fd{-1};
+        std::vector<block> bz_blocks;
+        uint64_t bz_scan_bit_offset{0};
+        nonstd::optional<uint64_t> bz_pending_start;
+        bool bz_scan_done{false};
+        file_off_t bz_source_offset{0};
+        std::map<size_t, block_data> bz_block_cache;
     };
 
     /** Construct an empty line_buffer. */
@@ -324,6 +402,18 @@ private:
 
     bool load_next_buffer();
 
+    /**
+     * Read decompressed data from a bzip2 file, using the block index when
+     * possible.
+     */
+    ssize_t bz_read(char* buf, file_off_t offset, size_t size);
+
+    /**
+     * Read decompressed data from a bzip2 file by decompressing from the
+     * start of the file.
+     */
+    ssize_t bz_read_from_start(char* buf, file_off_t offset, size_t size);
+
     using safe_gz_indexed = safe::Safe<gz_indexed>;
 
     shared_buffer lb_share_manager;
@@ -331,6 +421,11 @@ private:
     auto_fd lb_fd; /*< The file to read data from. */
     safe_gz_indexed lb_gz_file; /*< File reader for gzipped files. */
     bool lb_bz_file{false}; /*< Flag set for bzip2 compressed files. */
+    /**
+     * Block reader for bzip2 files, access is serialized by the lock on
+     * lb_gz_file.
+     */
+    bz_indexed lb_bz_index;
 
     auto_buffer lb_buffer{auto_buffer::alloc(DEFAULT_LINE_BUFFER_SIZE)};
     nonstd::optional<auto_buffer> lb_alt_buffer;
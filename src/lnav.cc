@@ -94,6 +94,7 @@
 #include "CLI/CLI.hpp"
 #include "dump_internals.hh"
 #include "environ_vtab.hh"
+#include "file_watcher.hh"
 #include "filter_sub_source.hh"
 #include "fstat_vtab.hh"
 #include "grep_proc.hh"
@@ -1061,6 +1062,33 @@ struct refresh_status_bars {
     std::shared_ptr<top_status_source> rsb_top_source;
 };
 
+/**
+ * Point the file watcher at the open files and at the directories where new
+ * files matching the given paths and globs can show up.
+ */
+static void
+sync_file_watcher(file_watcher& watcher)
+{
+    std::set<std::string> files;
+    std::set<std::string> dirs;
+
+    for (const auto& lf : lnav_data.ld_active_files.fc_files) {
+        if (lf->is_valid_filename()) {
+            files.insert(lf->get_filename());
+        }
+    }
+    for (const auto& pair : lnav_data.ld_active_files.fc_file_names) {
+        if (pair.second.loo_temp_file || is_url(pair.first)) {
+            continue;
+        }
+
+        auto parent = ghc::filesystem::path(pair.first).parent_path();
+        dirs.insert(parent.empty() ? "." : parent.string());
+    }
+
+    watcher.sync(files, dirs);
+}
+
 static void
 looper()
 {
@@ -1503,6 +1531,16 @@ looper()
         auto next_rebuild_time = ui_clock::now();
         auto next_status_update_time = next_rebuild_time;
         auto next_rescan_time = next_rebuild_time;
+        // Rebuilds and rescans are held off until this time after user
+        // input, even if the file watcher notices a change.
+        auto input_hold_time = next_rebuild_time;
+        auto watcher = injector::get<std::shared_ptr<file_watcher>>();
+        // When every file and directory is watched, the polling is only
+        // a fallback and does not need to happen as often.
+        auto poll_interval = [&watcher]() {
+            return watcher->is_watching_all() ? ui_clock::duration{3s}
+                                              : ui_clock::duration{333ms};
+        };
 
         while (lnav_data.ld_looping) {
             auto loop_deadline
@@ -1567,9 +1605,11 @@ looper()
                     }
                 }
 
+                sync_file_watcher(*watcher);
+
                 active_copy.clear();
                 rescan_future = std::future<file_collection>{};
-                next_rescan_time = ui_clock::now() + 333ms;
+                next_rescan_time = ui_clock::now() + poll_interval();
             }
 
             if (!rescan_future.valid()
@@ -1596,7 +1636,7 @@ looper()
                     auto text_file_count = lnav_data.ld_text_source.size();
                     changes += rebuild_indexes(loop_deadline);
                     if (!changes && ui_clock::now() < loop_deadline) {
-                        next_rebuild_time = ui_clock::now() + 333ms;
+                        next_rebuild_time = ui_clock::now() + poll_interval();
                     }
                     if (changes && text_file_count
                         && lnav_data.ld_text_source.empty()
@@ -1778,6 +1818,7 @@ looper()
                             break;
                     }
                     next_rebuild_time = next_rescan_time;
+                    input_hold_time = next_rescan_time;
                 }
 
                 auto old_mode = lnav_data.ld_mode;
@@ -1795,11 +1836,21 @@ looper()
                         case ln_mode_t::FILES:
                             next_rescan_time = next_status_update_time + 1s;
                             next_rebuild_time = next_rescan_time;
+                            input_hold_time = next_rescan_time;
                             break;
                         default:
                             break;
                     }
                 }
+
+                auto fw_changes = watcher->consume_changes();
+                auto fw_time = std::max(ui_clock::now(), input_hold_time);
+                if (fw_changes.c_files && fw_time < next_rebuild_time) {
+                    next_rebuild_time = fw_time;
+                }
+                if (fw_changes.c_dirs && fw_time < next_rescan_time) {
+                    next_rescan_time = fw_time;
+                }
                 if (old_file_names_size
                     != lnav_data.ld_active_files.fc_file_names.size())
                 {
@@ -1900,6 +1951,7 @@ looper()
 
                     if (!ran_cleanup) {
                         line_buffer::cleanup_cache();
+                        logfile::cleanup_index_cache();
                         archive_manager::cleanup_cache();
                         tailer::cleanup_cache();
                         ran_cleanup = true;
@@ -3168,6 +3220,7 @@ SELECT tbl_name FROM sqlite_master WHERE sql LIKE 'CREATE VIRTUAL TABLE%'
                 archive_manager::cleanup_cache();
                 tailer::cleanup_cache();
                 line_buffer::cleanup_cache();
+                logfile::cleanup_index_cache();
                 wait_for_pipers();
                 isc::to<curl_looper&, services::curl_streamer_t>()
                     .send_and_wait(
@@ -1855,12 +1855,6 @@ com_filter(exec_context& ec,
             return com_enable_filter(ec, cmdline, args);
         }
 
-        if (fs.full()) {
-            return ec.make_error(
-                "filter limit reached, try combining "
-                "filters with a pipe symbol (e.g. foo|bar)");
-        }
-
         auto compile_res = lnav::pcre2pp::code::from(args[1], PCRE2_CASELESS);
 
         if (compile_res.isErr()) {
@@ -1895,12 +1889,8 @@ com_filter(exec_context& ec,
             text_filter::type_t lt = (args[0] == "filter-out")
                 ? text_filter::EXCLUDE
                 : text_filter::INCLUDE;
-            auto filter_index = fs.next_index();
-            if (!filter_index) {
-                return ec.make_error("too many filters");
-            }
             auto pf = std::make_shared<pcre_filter>(
-                lt, args[1], *filter_index, compile_res.unwrap().to_shared());
+                lt, args[1], fs.next_index(), compile_res.unwrap().to_shared());
 
             log_debug("%s [%d] %s",
                       args[0].c_str(),
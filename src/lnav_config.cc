@@ -87,6 +87,9 @@ static auto fvc = injector::bind<file_vtab::config>::to_instance(
 static auto lc = injector::bind<lnav::logfile::config>::to_instance(
     +[]() { return &lnav_config.lc_logfile; });
 
+static auto gpc = injector::bind<grep_proc_ns::config>::to_instance(
+    +[]() { return &lnav_config.lc_grep_proc; });
+
 static auto tc = injector::bind<tailer::config>::to_instance(
     +[]() { return &lnav_config.lc_tailer; });
 
@@ -1075,6 +1078,39 @@ static const struct json_path_container logfile_handlers = {
         .with_min_value(1)
         .for_field(&_lnav_config::lc_logfile,
                    &lnav::logfile::config::lc_max_unrecognized_lines),
+    yajlpp::property_handler("indexing-threads")
+        .with_synopsis("<count>")
+        .with_description("The number of threads to use when indexing log "
+                          "files, merging their indexes, and applying filters "
+                          "in parallel.  A value of zero will use one thread "
+                          "per CPU")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_indexing_threads),
+    yajlpp::property_handler("trigram-index")
+        .with_synopsis("bool")
+        .with_description("Index the trigrams in plain-text log lines so that "
+                          "searches and filters with literal text can skip "
+                          "the lines that cannot match")
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_trigram_index),
+};
+
+static const struct json_path_container search_handlers = {
+    yajlpp::property_handler("threads")
+        .with_synopsis("<count>")
+        .with_description("The number of threads to use when matching lines "
+                          "for a search.  A value of zero will use one "
+                          "thread per CPU")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_grep_proc,
+                   &grep_proc_ns::config::c_threads),
+    yajlpp::property_handler("use-child-process")
+        .with_synopsis("bool")
+        .with_description("Run searches in a forked child process instead of "
+                          "in threads within lnav")
+        .for_field(&_lnav_config::lc_grep_proc,
+                   &grep_proc_ns::config::c_use_child_process),
 };
 
 static const struct json_path_container ssh_config_handlers = {
@@ -1251,6 +1287,9 @@ static const struct json_path_container tuning_handlers = {
     yajlpp::property_handler("logfile")
         .with_description("Settings related to log files")
         .with_children(logfile_handlers),
+    yajlpp::property_handler("search")
+        .with_description("Settings related to searching")
+        .with_children(search_handlers),
     yajlpp::property_handler("remote")
         .with_description("Settings related to remote file support")
         .with_children(remote_handlers),
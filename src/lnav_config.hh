@@ -45,6 +45,7 @@
 #include "base/result.h"
 #include "file_vtab.cfg.hh"
 #include "ghc/filesystem.hpp"
+#include "grep_proc.cfg.hh"
 #include "lnav_config_fwd.hh"
 #include "log_level.hh"
 #include "logfile.cfg.hh"
@@ -111,6 +112,7 @@ struct _lnav_config {
     archive_manager::config lc_archive_manager;
     file_vtab::config lc_file_vtab;
     lnav::logfile::config lc_logfile;
+    grep_proc_ns::config lc_grep_proc;
     tailer::config lc_tailer;
     sysclip::config lc_sysclip;
     logfile_sub_source_ns::config lc_log_source;
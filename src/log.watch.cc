@@ -27,6 +27,8 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <mutex>
+
 #include "log.watch.hh"
 
 #include <sqlite3.h>
@@ -117,6 +119,11 @@ eval_with(logfile& lf, logfile::iterator ll)
         return;
     }
 
+    // The prepared statements are shared, so evaluation needs to be
+    // serialized when files are being indexed in parallel.
+    static std::mutex eval_mutex;
+    std::lock_guard<std::mutex> eval_lock(eval_mutex);
+
     static auto& lnav_db = injector::get<auto_sqlite3&>();
 
     char timestamp_buffer[64] = "";
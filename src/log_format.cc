@@ -28,11 +28,13 @@
  */
 
 #include <memory>
+#include <mutex>
 
 #include <fnmatch.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "base/literal_prefilter.hh"
 #include "base/snippet_highlighters.hh"
 #include "base/string_util.hh"
 #include "command_executor.hh"
@@ -61,6 +63,7 @@ string_attr_type<void> logline::L_OPID("opid");
 string_attr_type<bookmark_metadata*> logline::L_META("meta");
 
 external_log_format::mod_map_t external_log_format::MODULE_FORMATS;
+static std::mutex module_formats_mutex;
 std::vector<std::shared_ptr<external_log_format>>
     external_log_format::GRAPH_ORDERED_FORMATS;
 
@@ -835,6 +838,8 @@ external_log_format::scan(logfile& lf,
 
     int curr_fmt = -1, orig_lock = this->last_pattern_index();
     int pat_index = orig_lock;
+    int first_fmt = -1;
+    bool prefiltered = false;
     auto line_sf = sbr.to_string_fragment();
 
     while (::next_format(this->elf_pattern_order, curr_fmt, pat_index)) {
@@ -847,6 +852,26 @@ external_log_format::scan(logfile& lf,
             continue;
         }
 
+        /*
+         * The first pattern tried is usually the locked one and matches, so
+         * the prefilter is only run after that fails.  It then narrows the
+         * remaining patterns down to the ones with literals in the line.
+         */
+        if (first_fmt == -1) {
+            first_fmt = curr_fmt;
+        } else if (curr_fmt == first_fmt) {
+            continue;
+        } else if (this->elf_pattern_prefilter) {
+            if (!prefiltered) {
+                this->elf_pattern_prefilter->scan(
+                    line_sf, this->elf_pattern_candidates);
+                prefiltered = true;
+            }
+            if (!this->elf_pattern_candidates[curr_fmt]) {
+                continue;
+            }
+        }
+
         auto match_res = pat->capture_from(line_sf)
                              .into(md)
                              .matches(PCRE2_NO_UTF_CHECK)
@@ -929,6 +954,9 @@ external_log_format::scan(logfile& lf,
         }
 
         if (mod_cap) {
+            // Files can be indexed in parallel, so access to the shared
+            // module formats needs to be serialized.
+            std::lock_guard<std::mutex> mod_lock(module_formats_mutex);
             intern_string_t mod_name = intern_string::lookup(mod_cap.value());
             auto mod_iter = MODULE_FORMATS.find(mod_name);
 
@@ -1822,6 +1850,26 @@ external_log_format::get_subline(const logline& ll,
     this->jlf_line_values.lvv_sbr = sbr;
 }
 
+/**
+ * @return The longest literal that must be present in a line for the pattern
+ *   to match or an empty string if there is none.
+ */
+static std::string
+required_literal_for(const external_log_format::pattern& pat)
+{
+    auto lits = pat.p_pcre.pp_value->get_required_literals();
+
+    if (lits.empty()) {
+        return "";
+    }
+
+    // The longest literal should be the rarest one.
+    return *std::max_element(
+        lits.begin(), lits.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.size() < rhs.size();
+        });
+}
+
 void
 external_log_format::build(std::vector<lnav::console::user_message>& errors)
 {
@@ -1962,6 +2010,28 @@ external_log_format::build(std::vector<lnav::console::user_message>& errors)
         this->elf_pattern_order.push_back(iter->second);
     }
 
+    if (this->elf_pattern_order.size() > 1) {
+        std::vector<std::vector<std::string>> groups;
+        size_t ruled_out = 0;
+
+        for (const auto& pat : this->elf_pattern_order) {
+            groups.emplace_back();
+            if (pat->p_module_format) {
+                continue;
+            }
+
+            auto lit = required_literal_for(*pat);
+            if (!lit.empty()) {
+                groups.back().emplace_back(std::move(lit));
+                ruled_out += 1;
+            }
+        }
+        if (ruled_out > 0) {
+            this->elf_pattern_prefilter
+                = std::make_shared<literal_prefilter>(groups);
+        }
+    }
+
     if (this->elf_type != elf_type_t::ELF_TYPE_TEXT) {
         if (!this->elf_patterns.empty()) {
             errors.emplace_back(
@@ -2944,6 +3014,35 @@ external_log_format::match_mime_type(const file_format_t ff) const
     return this->elf_mime_types.count(ff) == 1;
 }
 
+std::vector<std::string>
+external_log_format::get_detection_literals() const
+{
+    std::vector<std::string> retval;
+
+    switch (this->elf_type) {
+        case elf_type_t::ELF_TYPE_JSON:
+            retval.emplace_back("{");
+            break;
+        case elf_type_t::ELF_TYPE_TEXT:
+            for (const auto& pat : this->elf_pattern_order) {
+                if (pat->p_module_format) {
+                    continue;
+                }
+
+                auto lit = required_literal_for(*pat);
+                if (lit.empty()) {
+                    return {};
+                }
+                retval.emplace_back(std::move(lit));
+            }
+            break;
+        default:
+            break;
+    }
+
+    return retval;
+}
+
 long
 external_log_format::value_line_count(const intern_string_t ist,
                                       bool top_level,
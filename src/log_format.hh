@@ -354,6 +354,18 @@ public:
         return false;
     }
 
+    /**
+     * Get the strings used to quickly rule out this format during detection.
+     *
+     * @return Literal strings where at least one must be present in a line
+     *   for it to possibly match this format.  If the vector is empty, any
+     *   line might match.
+     */
+    virtual std::vector<std::string> get_detection_literals() const
+    {
+        return {};
+    }
+
     enum scan_result_t {
         SCAN_MATCH,
         SCAN_NO_MATCH,
@@ -425,6 +437,12 @@ public:
     {
     }
 
+    /**
+     * @return True if get_subline() leaves the lines as they are in the
+     * file.
+     */
+    virtual bool has_raw_sublines() const { return true; }
+
     virtual const std::vector<std::string>* get_actions(
         const logline_value& lv) const
     {
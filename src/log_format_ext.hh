@@ -34,6 +34,7 @@
 
 #include <unordered_map>
 
+#include "base/literal_prefilter.hh"
 #include "log_format.hh"
 #include "log_search_table_fwd.hh"
 #include "yajlpp/yajlpp.hh"
@@ -143,6 +144,8 @@ public:
 
     bool match_mime_type(const file_format_t ff) const;
 
+    std::vector<std::string> get_detection_literals() const;
+
     scan_result_t scan(logfile& lf,
                        std::vector<logline>& dst,
                        const line_info& offset,
@@ -200,6 +203,11 @@ public:
                      shared_buffer_ref& sbr,
                      bool full_message);
 
+    bool has_raw_sublines() const
+    {
+        return this->elf_type == elf_type_t::ELF_TYPE_TEXT;
+    }
+
     std::shared_ptr<log_vtab_impl> get_vtab_impl() const;
 
     const std::vector<std::string>* get_actions(const logline_value& lv) const
@@ -332,6 +340,9 @@ public:
     factory_container<lnav::pcre2pp::code> elf_filename_pcre;
     std::map<std::string, std::shared_ptr<pattern>> elf_patterns;
     std::vector<std::shared_ptr<pattern>> elf_pattern_order;
+    // Rules out patterns that cannot match a line before running them.
+    std::shared_ptr<const literal_prefilter> elf_pattern_prefilter;
+    std::vector<bool> elf_pattern_candidates;
     std::vector<sample> elf_samples;
     std::unordered_map<const intern_string_t, std::shared_ptr<value_def>>
         elf_value_defs;
@@ -69,6 +69,7 @@ struct scan_batch_context {
 /**
  * Metadata for a single line in a log file.
  */
+#pragma pack(push, 4)
 class logline {
 public:
     static string_attr_type<void> L_PREFIX;
@@ -93,9 +94,9 @@ public:
             log_level_t lev,
             uint8_t mod = 0,
             uint8_t opid = 0)
-        : ll_offset(off), ll_has_ansi(false), ll_time(t), ll_millis(millis),
-          ll_opid(opid), ll_sub_offset(0), ll_valid_utf(1), ll_level(lev),
-          ll_module_id(mod), ll_expr_mark(0)
+        : ll_offset(off), ll_has_ansi(false), ll_valid_utf(1),
+          ll_millis(millis), ll_opid(opid), ll_time(t), ll_sub_offset(0),
+          ll_expr_mark(0), ll_level(lev), ll_module_id(mod)
     {
         memset(this->ll_schema, 0, sizeof(this->ll_schema));
     }
@@ -105,8 +106,8 @@ public:
             log_level_t lev,
             uint8_t mod = 0,
             uint8_t opid = 0)
-        : ll_offset(off), ll_has_ansi(false), ll_opid(opid), ll_sub_offset(0),
-          ll_valid_utf(1), ll_level(lev), ll_module_id(mod), ll_expr_mark(0)
+        : ll_offset(off), ll_has_ansi(false), ll_valid_utf(1), ll_opid(opid),
+          ll_sub_offset(0), ll_expr_mark(0), ll_level(lev), ll_module_id(mod)
     {
         this->set_time(tv);
         memset(this->ll_schema, 0, sizeof(this->ll_schema));
@@ -124,7 +125,9 @@ public:
 
     void to_exttm(struct exttm& tm_out) const
     {
-        tm_out.et_tm = *gmtime(&this->ll_time);
+        time_t t = this->ll_time;
+
+        tm_out.et_tm = *gmtime(&t);
         tm_out.et_nsec = this->ll_millis * 1000 * 1000;
     }
 
@@ -142,7 +145,10 @@ public:
 
     struct timeval get_timeval() const
     {
-        struct timeval retval = {this->ll_time, this->ll_millis * 1000};
+        struct timeval retval = {
+            (time_t) this->ll_time,
+            (suseconds_t) (this->ll_millis * 1000),
+        };
 
         return retval;
     }
@@ -297,18 +303,28 @@ public:
     }
 
 private:
-    file_off_t ll_offset : 63;
-    uint8_t ll_has_ansi : 1;
-    time_t ll_time;
-    unsigned int ll_millis : 10;
-    unsigned int ll_opid : 6;
-    unsigned int ll_sub_offset : 15;
-    unsigned int ll_valid_utf : 1;
+    /*
+     * The fields are packed into two 64-bit words and a trailing 32-bit
+     * word so that a line only takes 20 bytes in the index instead of 24.
+     * An offset of 46 bits allows for 64TB of (uncompressed) data per file
+     * and 44 bits of seconds covers more than 270,000 years either side
+     * of the epoch.
+     */
+    file_off_t ll_offset : 46;
+    uint64_t ll_has_ansi : 1;
+    uint64_t ll_valid_utf : 1;
+    uint64_t ll_millis : 10;
+    uint64_t ll_opid : 6;
+    int64_t ll_time : 44;
+    uint64_t ll_sub_offset : 15;
+    uint64_t ll_expr_mark : 1;
     uint8_t ll_level;
-    uint8_t ll_module_id : 7;
-    uint8_t ll_expr_mark : 1;
+    uint8_t ll_module_id;
     char ll_schema[2];
 };
+#pragma pack(pop)
+
+static_assert(sizeof(logline) == 20, "logline should be packed into 20 bytes");
 
 struct format_tag_def {
     explicit format_tag_def(std::string name) : ftd_name(std::move(name)) {}
@@ -773,10 +773,10 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
         }
 
         case VT_COL_FILTERS: {
-            const auto& filter_mask
-                = (*ld)->ld_filter_state.lfo_filter_state.tfs_mask;
+            const auto& filter_state
+                = (*ld)->ld_filter_state.lfo_filter_state;
 
-            if (!filter_mask[line_number]) {
+            if (!filter_state.has_filter_match(line_number)) {
                 sqlite3_result_null(ctx);
             } else {
                 const auto& filters = vt->lss->get_filters();
@@ -792,9 +792,9 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
                             continue;
                         }
 
-                        uint32_t mask = (1UL << filter->get_index());
-
-                        if (filter_mask[line_number] & mask) {
+                        if (filter_state.is_filter_match(filter->get_index(),
+                                                         line_number))
+                        {
                             arr.gen(filter->get_index());
                         }
                     }
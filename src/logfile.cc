@@ -29,6 +29,9 @@
  * @file logfile.cc
  */
 
+#include <future>
+#include <map>
+#include <mutex>
 #include <utility>
 
 #include "logfile.hh"
@@ -45,6 +48,8 @@
 #include "base/ansi_scrubber.hh"
 #include "base/fs_util.hh"
 #include "base/injector.hh"
+#include "base/literal_prefilter.hh"
+#include "base/paths.hh"
 #include "base/string_util.hh"
 #include "config.h"
 #include "lnav_util.hh"
@@ -148,7 +153,393 @@ logfile::logfile(std::string filename, logfile_open_options& loo)
     this->lf_opids.writeAccess()->reserve(64);
 }
 
-logfile::~logfile() {}
+logfile::~logfile()
+{
+    this->save_index_cache();
+}
+
+namespace {
+
+static const char INDEX_CACHE_MAGIC[8] = {'l', 'n', 'a', 'v', 'i', 'd', 'x', 0};
+static const uint32_t INDEX_CACHE_VERSION = 1;
+static const file_ssize_t INDEX_CACHE_MIN_SIZE = 1024 * 1024;
+static const file_ssize_t INDEX_CACHE_PREFIX_SIZE = 4 * 1024;
+
+/**
+ * The fixed-size header at the start of an index cache file.  It is
+ * followed by the loglines, the pattern locks, the value stats, and then
+ * the variable-length strings.  The header is a multiple of eight bytes
+ * so that the loglines are suitably aligned if the file is mmap()'d.
+ */
+struct index_cache_header {
+    char ich_magic[8];
+    uint32_t ich_version;
+    uint32_t ich_logline_size;
+    uint64_t ich_dev;
+    uint64_t ich_ino;
+    int64_t ich_file_size;
+    int64_t ich_mtime;
+    int64_t ich_index_size;
+    uint64_t ich_line_count;
+    uint64_t ich_longest_line;
+    uint64_t ich_pattern_lock_count;
+    uint64_t ich_value_stats_count;
+    uint64_t ich_opid_count;
+};
+
+static ghc::filesystem::path
+index_cache_path()
+{
+    return lnav::paths::workdir() / "index-cache";
+}
+
+static ghc::filesystem::path
+index_cache_file_for(const struct stat& st)
+{
+    auto base_name = hasher()
+                         .update(st.st_dev)
+                         .update(st.st_ino)
+                         .to_string();
+
+    return index_cache_path() / base_name.substr(0, 2)
+        / fmt::format(FMT_STRING("{}.idx"), base_name);
+}
+
+static bool
+write_all(int fd, const void* buf, size_t len)
+{
+    const auto* bits = static_cast<const char*>(buf);
+
+    while (len > 0) {
+        auto rc = write(fd, bits, len);
+
+        if (rc <= 0) {
+            if (rc == -1 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bits += rc;
+        len -= rc;
+    }
+
+    return true;
+}
+
+static bool
+read_all(int fd, void* buf, size_t len)
+{
+    auto* bits = static_cast<char*>(buf);
+
+    while (len > 0) {
+        auto rc = read(fd, bits, len);
+
+        if (rc <= 0) {
+            if (rc == -1 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bits += rc;
+        len -= rc;
+    }
+
+    return true;
+}
+
+static bool
+write_string(int fd, const string_fragment& sf)
+{
+    uint32_t len = sf.length();
+
+    return write_all(fd, &len, sizeof(len)) && write_all(fd, sf.data(), len);
+}
+
+static bool
+read_string(int fd, std::string& str_out)
+{
+    uint32_t len;
+
+    if (!read_all(fd, &len, sizeof(len))) {
+        return false;
+    }
+    str_out.resize(len);
+    return read_all(fd, &str_out[0], len);
+}
+
+}  // namespace
+
+void
+logfile::save_index_cache()
+{
+    if (!this->lf_named_file || !this->lf_valid_filename
+        || this->lf_format == nullptr || this->lf_format->lf_is_self_describing
+        || this->lf_index.empty() || this->lf_stat.st_size < INDEX_CACHE_MIN_SIZE
+        || this->lf_index_size == this->lf_index_cache_size
+        || this->is_time_adjusted() || !this->lf_applicable_taggers.empty())
+    {
+        return;
+    }
+
+    // Files that were closed because they were overwritten will have a
+    // different stat() than when they were last indexed.
+    struct stat st;
+
+    if (fstat(this->lf_line_buffer.get_fd(), &st) == -1
+        || st.st_size != this->lf_stat.st_size
+        || st.st_mtime != this->lf_stat.st_mtime)
+    {
+        return;
+    }
+
+    auto prefix_res = this->lf_line_buffer.read_range(
+        {0, std::min(this->lf_index_size, INDEX_CACHE_PREFIX_SIZE)});
+    if (prefix_res.isErr()) {
+        return;
+    }
+    auto prefix_hash = hasher()
+                           .update(prefix_res.unwrap().to_string_fragment())
+                           .to_string();
+
+    auto cache_file = index_cache_file_for(this->lf_stat);
+    auto tmp_file = cache_file;
+    tmp_file += fmt::format(FMT_STRING(".{}.tmp"), getpid());
+
+    std::error_code ec;
+    ghc::filesystem::create_directories(cache_file.parent_path(), ec);
+
+    auto create_res
+        = lnav::filesystem::create_file(tmp_file, O_WRONLY | O_TRUNC, 0600);
+    if (create_res.isErr()) {
+        log_error("unable to create index cache: %s -- %s",
+                  tmp_file.c_str(),
+                  create_res.unwrapErr().c_str());
+        return;
+    }
+
+    auto cache_fd = create_res.unwrap();
+    const auto& pattern_locks = this->lf_format->lf_pattern_locks;
+    const auto& value_stats = this->lf_format->lf_value_stats;
+    safe::ReadAccess<logfile::safe_opid_map> opids(this->lf_opids);
+    index_cache_header ich;
+
+    memset(&ich, 0, sizeof(ich));
+    memcpy(ich.ich_magic, INDEX_CACHE_MAGIC, sizeof(ich.ich_magic));
+    ich.ich_version = INDEX_CACHE_VERSION;
+    ich.ich_logline_size = sizeof(logline);
+    ich.ich_dev = this->lf_stat.st_dev;
+    ich.ich_ino = this->lf_stat.st_ino;
+    ich.ich_file_size = this->lf_stat.st_size;
+    ich.ich_mtime = this->lf_stat.st_mtime;
+    ich.ich_index_size = this->lf_index_size;
+    ich.ich_line_count = this->lf_index.size();
+    ich.ich_longest_line = this->lf_longest_line;
+    ich.ich_pattern_lock_count = pattern_locks.size();
+    ich.ich_value_stats_count = value_stats.size();
+    ich.ich_opid_count = opids->size();
+
+    auto ok = write_all(cache_fd, &ich, sizeof(ich))
+        && write_all(cache_fd,
+                     this->lf_index.data(),
+                     this->lf_index.size() * sizeof(logline))
+        && write_all(cache_fd,
+                     pattern_locks.data(),
+                     pattern_locks.size()
+                         * sizeof(log_format::pattern_for_lines))
+        && write_all(cache_fd,
+                     value_stats.data(),
+                     value_stats.size() * sizeof(logline_value_stats))
+        && write_string(cache_fd, this->lf_format->get_name().to_string_fragment())
+        && write_string(cache_fd, this->lf_content_id)
+        && write_string(cache_fd, prefix_hash);
+    for (auto iter = opids->begin(); ok && iter != opids->end(); ++iter) {
+        ok = write_string(cache_fd, iter->first)
+            && write_all(cache_fd, &iter->second, sizeof(iter->second));
+    }
+
+    if (!ok) {
+        log_error("unable to write index cache: %s -- %s",
+                  tmp_file.c_str(),
+                  strerror(errno));
+        ghc::filesystem::remove(tmp_file, ec);
+        return;
+    }
+
+    ghc::filesystem::rename(tmp_file, cache_file, ec);
+    if (ec) {
+        log_error("unable to rename index cache: %s -- %s",
+                  cache_file.c_str(),
+                  ec.message().c_str());
+        ghc::filesystem::remove(tmp_file, ec);
+        return;
+    }
+
+    log_info("%s: saved index cache with %zu lines -- %s",
+             this->lf_filename.c_str(),
+             this->lf_index.size(),
+             cache_file.c_str());
+}
+
+bool
+logfile::load_index_cache(const struct stat& st)
+{
+    if (!this->lf_named_file || !this->lf_valid_filename
+        || !this->lf_options.loo_detect_format
+        || st.st_size < INDEX_CACHE_MIN_SIZE)
+    {
+        return false;
+    }
+
+    auto cache_file = index_cache_file_for(st);
+    auto open_res = lnav::filesystem::open_file(cache_file, O_RDONLY);
+    if (open_res.isErr()) {
+        return false;
+    }
+
+    auto cache_fd = open_res.unwrap();
+    index_cache_header ich;
+
+    if (!read_all(cache_fd, &ich, sizeof(ich))
+        || memcmp(ich.ich_magic, INDEX_CACHE_MAGIC, sizeof(ich.ich_magic)) != 0
+        || ich.ich_version != INDEX_CACHE_VERSION
+        || ich.ich_logline_size != sizeof(logline)
+        || ich.ich_dev != (uint64_t) st.st_dev
+        || ich.ich_ino != (uint64_t) st.st_ino || ich.ich_line_count == 0)
+    {
+        log_info("%s: ignoring incompatible index cache",
+                 this->lf_filename.c_str());
+        return false;
+    }
+
+    if (st.st_size < ich.ich_file_size
+        || (st.st_size == ich.ich_file_size && st.st_mtime != ich.ich_mtime))
+    {
+        log_info("%s: file was rewritten, ignoring index cache",
+                 this->lf_filename.c_str());
+        return false;
+    }
+
+    std::vector<logline> index;
+    std::vector<log_format::pattern_for_lines> pattern_locks;
+    std::vector<logline_value_stats> value_stats;
+    std::string format_name, content_id, prefix_hash;
+
+    index.resize(ich.ich_line_count, logline{0, 0, 0, LEVEL_UNKNOWN});
+    pattern_locks.resize(ich.ich_pattern_lock_count,
+                         log_format::pattern_for_lines{0, 0});
+    value_stats.resize(ich.ich_value_stats_count);
+    if (!read_all(cache_fd, index.data(), index.size() * sizeof(logline))
+        || !read_all(cache_fd,
+                     pattern_locks.data(),
+                     pattern_locks.size()
+                         * sizeof(log_format::pattern_for_lines))
+        || !read_all(cache_fd,
+                     value_stats.data(),
+                     value_stats.size() * sizeof(logline_value_stats))
+        || !read_string(cache_fd, format_name)
+        || !read_string(cache_fd, content_id)
+        || !read_string(cache_fd, prefix_hash))
+    {
+        log_error("%s: truncated index cache", this->lf_filename.c_str());
+        return false;
+    }
+
+    log_opid_map opids;
+    for (uint64_t lpc = 0; lpc < ich.ich_opid_count; lpc++) {
+        std::string opid;
+        opid_time_range otr;
+
+        if (!read_string(cache_fd, opid)
+            || !read_all(cache_fd, &otr, sizeof(otr)))
+        {
+            log_error("%s: truncated index cache", this->lf_filename.c_str());
+            return false;
+        }
+        opids.emplace(
+            string_fragment::from_str(opid).to_owned(this->lf_allocator), otr);
+    }
+
+    auto prefix_res = this->lf_line_buffer.read_range(
+        {0, std::min((file_ssize_t) ich.ich_index_size, INDEX_CACHE_PREFIX_SIZE)});
+    if (prefix_res.isErr()
+        || hasher().update(prefix_res.unwrap().to_string_fragment()).to_string()
+            != prefix_hash)
+    {
+        log_info("%s: content changed, ignoring index cache",
+                 this->lf_filename.c_str());
+        return false;
+    }
+
+    std::shared_ptr<log_format> format;
+    for (const auto& root_format : log_format::get_root_formats()) {
+        if (root_format->get_name() == format_name.c_str()) {
+            format = root_format->specialized();
+            break;
+        }
+    }
+    if (format == nullptr || format->lf_value_stats.size() != value_stats.size())
+    {
+        log_info("%s: format %s is no longer available, ignoring index cache",
+                 this->lf_filename.c_str(),
+                 format_name.c_str());
+        return false;
+    }
+
+    format->lf_pattern_locks = std::move(pattern_locks);
+    format->lf_value_stats = std::move(value_stats);
+    this->lf_format = format;
+    this->set_format_base_time(this->lf_format.get());
+    this->lf_text_format = text_format_t::TF_LOG;
+    this->lf_content_id = content_id;
+    this->lf_index = std::move(index);
+    this->lf_index_size = ich.ich_index_size;
+    this->lf_index_cache_size = ich.ich_index_size;
+    this->lf_longest_line = ich.ich_longest_line;
+    *this->lf_opids.writeAccess() = std::move(opids);
+
+    log_info("%s: restored %zu lines from index cache -- %s",
+             this->lf_filename.c_str(),
+             this->lf_index.size(),
+             cache_file.c_str());
+
+    return true;
+}
+
+void
+logfile::cleanup_index_cache()
+{
+    (void) std::async(std::launch::async, []() {
+        auto now = ghc::filesystem::file_time_type::clock::now();
+        auto cache_path = index_cache_path();
+        std::vector<ghc::filesystem::path> to_remove;
+        std::error_code ec;
+
+        if (!ghc::filesystem::exists(cache_path, ec)) {
+            return;
+        }
+
+        for (const auto& cache_subdir :
+             ghc::filesystem::directory_iterator(cache_path, ec))
+        {
+            for (const auto& entry :
+                 ghc::filesystem::directory_iterator(cache_subdir, ec))
+            {
+                auto mtime = ghc::filesystem::last_write_time(entry.path(), ec);
+                auto exp_time = mtime + std::chrono::hours(24 * 7);
+                if (now < exp_time) {
+                    continue;
+                }
+
+                to_remove.emplace_back(entry.path());
+            }
+        }
+
+        for (auto& entry : to_remove) {
+            log_debug("removing index cache: %s", entry.c_str());
+            ghc::filesystem::remove_all(entry, ec);
+        }
+    });
+}
 
 bool
 logfile::exists() const
@@ -203,6 +594,52 @@ logfile::set_format_base_time(log_format* lf)
                                    this->lf_cached_base_tm.value());
 }
 
+namespace {
+
+/**
+ * Turn a file path into a glob that also matches its rotated or dated
+ * siblings, like "/var/log/app.1.log" to "/var/log/app.*.log".
+ */
+std::string
+detection_glob_for(const std::string& filename)
+{
+    std::string retval;
+    auto base_start = filename.rfind('/');
+    bool in_digits = false;
+
+    base_start = base_start == std::string::npos ? 0 : base_start + 1;
+    retval.reserve(filename.size());
+    retval.append(filename, 0, base_start);
+    for (size_t lpc = base_start; lpc < filename.size(); lpc++) {
+        if (isdigit(filename[lpc])) {
+            if (!in_digits) {
+                retval.push_back('*');
+            }
+            in_digits = true;
+        } else {
+            retval.push_back(filename[lpc]);
+            in_digits = false;
+        }
+    }
+
+    return retval;
+}
+
+}  // namespace
+
+const trigram_index*
+logfile::get_trigram_index() const
+{
+    if (this->lf_trigram_index.get_line_count() == 0) {
+        return nullptr;
+    }
+    if (this->lf_format != nullptr && !this->lf_format->has_raw_sublines()) {
+        return nullptr;
+    }
+
+    return &this->lf_trigram_index;
+}
+
 bool
 logfile::process_prefix(shared_buffer_ref& sbr,
                         const line_info& li,
@@ -224,16 +661,65 @@ logfile::process_prefix(shared_buffer_ref& sbr,
         /* We've locked onto a format, just use that scanner. */
         found = this->lf_format->scan(*this, this->lf_index, li, sbr, sbc);
     } else if (this->lf_options.loo_detect_format) {
+        // The root formats are shared by all files and carry state from the
+        // last scan, so detection has to be serialized when files are being
+        // indexed in parallel.
+        static std::mutex detect_mutex;
+        // The last format detected for a glob of the file's path, which is
+        // tried first for other files that match the same glob.  Catch-all
+        // formats are not recorded since they would shadow the more specific
+        // formats that come before them.
+        static std::map<std::string, intern_string_t> detected_formats;
+        // Narrows down the formats to try by checking for the literals that
+        // they require.
+        static std::unique_ptr<literal_prefilter> prefilter;
+        static std::vector<bool> candidates;
+        std::lock_guard<std::mutex> detect_lock(detect_mutex);
         const auto& root_formats = log_format::get_root_formats();
+        auto detect_glob = detection_glob_for(this->lf_filename);
+        auto hint_index = root_formats.size();
+
+        if (!prefilter || prefilter->get_group_count() != root_formats.size())
+        {
+            std::vector<std::vector<std::string>> groups;
+
+            for (const auto& format : root_formats) {
+                groups.emplace_back(format->get_detection_literals());
+            }
+            prefilter = std::make_unique<literal_prefilter>(groups);
+            log_info("format prefilter built with %zu literals for %zu formats",
+                     prefilter->get_literal_count(),
+                     root_formats.size());
+        }
+        prefilter->scan(sbr.to_string_fragment(), candidates);
+
+        auto detected_iter = detected_formats.find(detect_glob);
+        if (detected_iter != detected_formats.end()) {
+            for (size_t lpc = 0; lpc < root_formats.size(); lpc++) {
+                if (root_formats[lpc]->get_name() == detected_iter->second) {
+                    hint_index = lpc;
+                    break;
+                }
+            }
+        }
 
         /*
          * Try each scanner until we get a match.  Fortunately, the formats
          * tend to be sufficiently different that there are few ambiguities...
          */
-        for (auto iter = root_formats.begin();
-             iter != root_formats.end() && (found != log_format::SCAN_MATCH);
-             ++iter)
+        for (size_t lpc = 0;
+             lpc <= root_formats.size() && (found != log_format::SCAN_MATCH);
+             lpc++)
         {
+            // The hinted format goes first, followed by the rest in order.
+            auto format_index = lpc == 0 ? hint_index : lpc - 1;
+            if (format_index == root_formats.size()
+                || (lpc > 0 && format_index == hint_index))
+            {
+                continue;
+            }
+            auto iter = root_formats.begin() + format_index;
+
             if (this->lf_index.size()
                 >= (*iter)->lf_max_unrecognized_lines.value_or(
                     max_unrecognized_lines))
@@ -263,6 +749,9 @@ logfile::process_prefix(shared_buffer_ref& sbr,
                 }
                 continue;
             }
+            if (!candidates[format_index]) {
+                continue;
+            }
 
             (*iter)->clear();
             this->set_format_base_time(iter->get());
@@ -278,6 +767,9 @@ logfile::process_prefix(shared_buffer_ref& sbr,
                          this->lf_index.size(),
                          (*iter)->get_name().get());
 
+                if (prefilter->can_rule_out(format_index)) {
+                    detected_formats[detect_glob] = (*iter)->get_name();
+                }
                 this->lf_text_format = text_format_t::TF_LOG;
                 this->lf_format = (*iter)->specialized();
                 this->set_format_base_time(this->lf_format.get());
@@ -398,9 +890,29 @@ logfile::process_prefix(shared_buffer_ref& sbr,
     return retval;
 }
 
+bool
+logfile::has_unindexed_data() const
+{
+    struct stat st;
+
+    if (!this->lf_indexing || this->lf_is_closed) {
+        return false;
+    }
+
+    if (fstat(this->lf_line_buffer.get_fd(), &st) == -1) {
+        return false;
+    }
+
+    return this->lf_line_buffer.is_data_available(this->lf_index_size,
+                                                  st.st_size);
+}
+
 logfile::rebuild_result_t
 logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
 {
+    static const auto trigram_index_enabled
+        = injector::get<const lnav::logfile::config&>().lc_trigram_index;
+
     if (!this->lf_indexing) {
         if (this->lf_sort_needed) {
             this->lf_sort_needed = false;
@@ -445,6 +957,16 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
     {
         this->lf_activity.la_reads += 1;
 
+        if (this->lf_index.empty() && this->lf_format == nullptr
+            && this->load_index_cache(st))
+        {
+            // Let the observers see the restored lines, the last line will
+            // be rolled back and rescanned along with any new data below.
+            if (this->lf_logline_observer != nullptr) {
+                this->reobserve_from(this->begin());
+            }
+        }
+
         // We haven't reached the end of the file.  Note that we use the
         // line buffer's notion of the file size since it may be compressed.
         bool has_format = this->lf_format.get() != nullptr;
@@ -623,6 +1145,18 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
 
             if (old_size > this->lf_index.size()) {
                 old_size = 0;
+                this->lf_trigram_index.clear();
+            }
+
+            if (trigram_index_enabled) {
+                for (auto lpc = old_size; lpc < this->lf_index.size(); lpc++) {
+                    if (li.li_has_ansi || !li.li_valid_utf) {
+                        this->lf_trigram_index.add_unindexed_line(lpc);
+                    } else {
+                        this->lf_trigram_index.add_line(
+                            lpc, sbr.to_string_fragment());
+                    }
+                }
             }
 
             // Update this early so that line_length() works
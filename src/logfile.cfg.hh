@@ -37,6 +37,8 @@ namespace logfile {
 
 struct config {
     uint64_t lc_max_unrecognized_lines{1000};
+    uint64_t lc_indexing_threads{1};
+    bool lc_trigram_index{false};
 };
 
 }  // namespace logfile
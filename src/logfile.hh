@@ -47,6 +47,7 @@
 #include "ArenaAlloc/arenaalloc.h"
 #include "base/lnav_log.hh"
 #include "base/result.h"
+#include "base/trigram_index.hh"
 #include "bookmarks.hh"
 #include "byte_array.hh"
 #include "ghc/filesystem.hpp"
@@ -164,6 +165,13 @@ public:
 
     text_format_t get_text_format() const { return this->lf_text_format; }
 
+    /**
+     * @return The index of the trigrams in the lines of this file or nullptr
+     * if the index is disabled or the lines are not searched as they are in
+     * the file.
+     */
+    const trigram_index* get_trigram_index() const;
+
     /**
      * @return The last modified time of the file when the file was last
      * indexed.
@@ -313,6 +321,17 @@ public:
         this->lf_logfile_observer = lo;
     }
 
+    logfile_observer* get_logfile_observer() const
+    {
+        return this->lf_logfile_observer;
+    }
+
+    /**
+     * @return True if the file has grown or still has data that has not
+     * been indexed yet.
+     */
+    bool has_unindexed_data() const;
+
     void set_logline_observer(logline_observer* llo);
 
     logline_observer* get_logline_observer() const
@@ -368,6 +387,11 @@ public:
 
     void dump_stats();
 
+    /**
+     * Remove index cache files that have not been used in a while.
+     */
+    static void cleanup_index_cache();
+
     robin_hood::unordered_map<uint32_t, bookmark_metadata>&
     get_bookmark_metadata()
     {
@@ -398,6 +422,21 @@ protected:
 
     void set_format_base_time(log_format* lf);
 
+    /**
+     * Try to restore the line index from the on-disk cache that was
+     * written the last time this file was open.
+     *
+     * @param st The current stat() of the file.
+     * @return True if the index was restored.
+     */
+    bool load_index_cache(const struct stat& st);
+
+    /**
+     * Write the line index to the on-disk cache so that it can be
+     * restored the next time this file is opened.
+     */
+    void save_index_cache();
+
 private:
     logfile(std::string filename, logfile_open_options& loo);
 
@@ -412,6 +451,7 @@ private:
     struct stat lf_stat {};
     std::shared_ptr<log_format> lf_format;
     std::vector<logline> lf_index;
+    trigram_index lf_trigram_index;
     time_t lf_index_time{0};
     file_off_t lf_index_size{0};
     bool lf_sort_needed{false};
@@ -436,6 +476,7 @@ private:
     nonstd::optional<tm> lf_cached_base_tm;
 
     nonstd::optional<std::pair<file_off_t, size_t>> lf_next_line_cache;
+    file_off_t lf_index_cache_size{0};
     std::set<intern_string_t> lf_mismatched_formats;
     robin_hood::unordered_map<uint32_t, bookmark_metadata> lf_bookmark_metadata;
 
@@ -28,13 +28,17 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <future>
+#include <numeric>
+#include <thread>
 
 #include "logfile_sub_source.hh"
 
 #include <sqlite3.h>
 
 #include "base/ansi_scrubber.hh"
+#include "base/future_util.hh"
 #include "base/humanize.time.hh"
 #include "base/injector.hh"
 #include "base/itertools.hh"
@@ -45,6 +49,7 @@
 #include "k_merge_tree.h"
 #include "lnav.events.hh"
 #include "log_accel.hh"
+#include "logfile.cfg.hh"
 #include "logfile_sub_source.cfg.hh"
 #include "md2attr_line.hh"
 #include "readline_highlighters.hh"
@@ -575,10 +580,10 @@ logfile_sub_source::text_attrs_for_line(textview_curses& lv,
     }
 
     if (!this->lss_token_line->is_continued()) {
-        if (this->lss_preview_filter_stmt != nullptr) {
+        if (this->lss_preview_filter_expr) {
             int color;
             auto eval_res
-                = this->eval_sql_filter(this->lss_preview_filter_stmt.in(),
+                = this->eval_sql_filter(this->lss_preview_filter_expr,
                                         this->lss_token_file_data,
                                         this->lss_token_line);
             if (eval_res.isErr()) {
@@ -605,7 +610,7 @@ logfile_sub_source::text_attrs_for_line(textview_curses& lv,
         auto sql_filter_opt = this->get_sql_filter();
         if (sql_filter_opt) {
             auto* sf = (sql_filter*) sql_filter_opt.value().get();
-            auto eval_res = this->eval_sql_filter(sf->sf_filter_stmt.in(),
+            auto eval_res = this->eval_sql_filter(sf->sf_filter_expr,
                                                   this->lss_token_file_data,
                                                   this->lss_token_line);
             if (eval_res.isErr()) {
@@ -622,6 +627,320 @@ logfile_sub_source::text_attrs_for_line(textview_curses& lv,
     }
 }
 
+std::unordered_map<const logfile*, logfile::rebuild_result_t>
+logfile_sub_source::rebuild_files_in_parallel(
+    nonstd::optional<ui_clock::time_point> deadline)
+{
+    using file_result = std::pair<const logfile*, logfile::rebuild_result_t>;
+
+    static const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    std::unordered_map<const logfile*, logfile::rebuild_result_t> retval;
+    size_t thread_count = cfg.lc_indexing_threads;
+
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    if (thread_count == 1 || this->tss_view->is_paused()) {
+        return retval;
+    }
+    if (deadline && ui_clock::now() > deadline.value()) {
+        return retval;
+    }
+    // SQL filters are evaluated with a shared prepared statement, so they
+    // cannot be run from multiple threads.
+    if (this->get_sql_filter()) {
+        return retval;
+    }
+
+    std::vector<std::pair<std::shared_ptr<logfile>, logfile_observer*>>
+        pending;
+    for (const auto& ld : this->lss_files) {
+        auto lf = ld->get_file();
+
+        if (lf == nullptr || !lf->has_unindexed_data()) {
+            continue;
+        }
+
+        pending.emplace_back(lf, lf->get_logfile_observer());
+    }
+
+    if (pending.size() < 2) {
+        return retval;
+    }
+
+    log_debug("indexing %zu files using %zu threads",
+              pending.size(),
+              thread_count);
+
+    // The filters run as the lines are indexed and the prefilter they share
+    // is built lazily, so make sure that is done before starting.
+    this->get_filters().get_prefilter();
+
+    // The observers update the UI, so they are detached while the workers
+    // are running and notified after everything is done.
+    for (auto& pair : pending) {
+        pair.first->set_logfile_observer(nullptr);
+    }
+
+    {
+        lnav::futures::future_queue<file_result> fq(
+            [&retval](auto& res) { retval[res.first] = res.second; },
+            thread_count);
+
+        for (auto& pair : pending) {
+            auto* lf = pair.first.get();
+
+            fq.push_back(std::async(
+                std::launch::async, [lf, deadline]() -> file_result {
+                    try {
+                        return std::make_pair(lf, lf->rebuild_index(deadline));
+                    } catch (const line_buffer::error& e) {
+                        log_error("%s: unable to index file -- %s",
+                                  lf->get_filename().c_str(),
+                                  strerror(e.e_err));
+                        lf->close();
+                        return std::make_pair(
+                            lf, logfile::rebuild_result_t::INVALID);
+                    }
+                }));
+        }
+    }
+
+    for (auto& pair : pending) {
+        pair.first->set_logfile_observer(pair.second);
+        if (pair.second != nullptr) {
+            auto index_size = pair.first->get_index_size();
+
+            pair.second->logfile_indexing(pair.first, index_size, index_size);
+        }
+    }
+
+    return retval;
+}
+
+void
+logfile_sub_source::merge_files_in_parallel()
+{
+    using run_t = std::vector<indexed_content>;
+
+    static const auto& cfg = injector::get<const lnav::logfile::config&>();
+    static const size_t MIN_LINES_PER_PARTITION = 64 * 1024;
+    static const size_t SAMPLES_PER_RUN = 32;
+
+    logline_cmp line_cmper(*this);
+    size_t thread_count = cfg.lc_indexing_threads;
+    std::vector<logfile_data*> files;
+    size_t total_lines = 0;
+
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    for (auto& ld : this->lss_files) {
+        auto* lf = ld->get_file_ptr();
+
+        if (lf == nullptr) {
+            continue;
+        }
+
+        files.emplace_back(ld.get());
+        total_lines += lf->size();
+    }
+    if (files.empty()) {
+        return;
+    }
+
+    std::atomic<size_t> progress{0};
+    // Call the given function for each index in [0, count) using the
+    // worker threads while reporting progress from this thread.
+    auto run_workers = [this, thread_count, total_lines, &progress](
+                           size_t count, const std::function<void(size_t)>& func) {
+        std::atomic<size_t> next{0};
+        auto worker = [&next, count, &func]() {
+            for (auto index = next++; index < count; index = next++) {
+                func(index);
+            }
+        };
+
+        if (thread_count == 1 || count < 2) {
+            worker();
+            return;
+        }
+
+        std::vector<std::future<void>> workers;
+        for (size_t lpc = 0; lpc < std::min(thread_count, count); lpc++) {
+            workers.emplace_back(std::async(std::launch::async, worker));
+        }
+        for (auto& fut : workers) {
+            while (fut.wait_for(std::chrono::milliseconds(100))
+                   == std::future_status::timeout)
+            {
+                if (this->lss_sorting_observer) {
+                    this->lss_sorting_observer(
+                        *this, progress.load(), total_lines * 2);
+                }
+            }
+            fut.get();
+        }
+    };
+
+    if (this->lss_sorting_observer) {
+        this->lss_sorting_observer(*this, 0, total_lines * 2);
+    }
+
+    // Each file becomes a run of content lines that only needs to be sorted
+    // if the file is not in time-order.
+    std::vector<run_t> runs(files.size());
+    std::vector<std::vector<content_line_t>> marks(files.size());
+    run_workers(files.size(), [&](size_t run_index) {
+        auto* ld = files[run_index];
+        auto* lf = ld->get_file_ptr();
+        auto& run = runs[run_index];
+        auto file_base = ld->ld_file_index * MAX_LINES_PER_FILE;
+
+        run.reserve(lf->size());
+        for (size_t line_index = 0; line_index < lf->size(); line_index++) {
+            auto& ll = (*lf)[line_index];
+
+            if (ll.is_ignored()) {
+                continue;
+            }
+
+            if (ll.is_marked()) {
+                auto start_index = line_index;
+
+                while (start_index > 0 && (*lf)[start_index].is_continued()) {
+                    start_index -= 1;
+                }
+                marks[run_index].emplace_back(file_base + start_index);
+                ll.set_mark(false);
+            }
+            run.emplace_back(content_line_t(file_base + line_index));
+        }
+
+        if (!std::is_sorted(run.begin(), run.end(), line_cmper)) {
+            log_debug("%s: lines are not in time-order, sorting",
+                      lf->get_filename().c_str());
+            std::sort(run.begin(), run.end(), line_cmper);
+        }
+        progress += lf->size();
+    });
+
+    // Split the runs into time ranges that can be merged independently by
+    // picking splitters from a sample of every run.
+    size_t part_count = std::max(
+        (size_t) 1,
+        std::min(thread_count, total_lines / MIN_LINES_PER_PARTITION));
+    std::vector<indexed_content> splitters;
+    if (part_count > 1) {
+        std::vector<indexed_content> samples;
+
+        for (const auto& run : runs) {
+            for (size_t lpc = 1; lpc <= SAMPLES_PER_RUN && !run.empty(); lpc++)
+            {
+                samples.emplace_back(
+                    run[run.size() * lpc / (SAMPLES_PER_RUN + 1)]);
+            }
+        }
+        std::sort(samples.begin(), samples.end(), line_cmper);
+        for (size_t lpc = 1; lpc < part_count; lpc++) {
+            splitters.emplace_back(
+                samples[samples.size() * lpc / part_count]);
+        }
+    }
+
+    std::vector<std::vector<size_t>> bounds(part_count + 1,
+                                            std::vector<size_t>(runs.size()));
+    for (size_t run_index = 0; run_index < runs.size(); run_index++) {
+        const auto& run = runs[run_index];
+
+        for (size_t lpc = 0; lpc < splitters.size(); lpc++) {
+            bounds[lpc + 1][run_index] = std::distance(
+                run.begin(),
+                std::lower_bound(
+                    run.begin(), run.end(), splitters[lpc], line_cmper));
+        }
+        bounds[part_count][run_index] = run.size();
+    }
+
+    std::vector<run_t> parts(part_count);
+    run_workers(part_count, [&](size_t part_index) {
+        struct cursor {
+            size_t c_run;
+            size_t c_pos;
+            const logline* c_line;
+        };
+        auto cursor_cmp = [](const cursor& lhs, const cursor& rhs) {
+            if (*rhs.c_line < *lhs.c_line) {
+                return true;
+            }
+            if (*lhs.c_line < *rhs.c_line) {
+                return false;
+            }
+            return rhs.c_run < lhs.c_run;
+        };
+        auto line_for = [&files, &runs](size_t run_index, size_t pos) {
+            auto* lf = files[run_index]->get_file_ptr();
+
+            return &(*lf)[runs[run_index][pos].ic_value % MAX_LINES_PER_FILE];
+        };
+        const auto& start = bounds[part_index];
+        const auto& end = bounds[part_index + 1];
+        auto& part = parts[part_index];
+        std::vector<cursor> heap;
+        size_t part_size = 0;
+
+        for (size_t run_index = 0; run_index < runs.size(); run_index++) {
+            if (start[run_index] < end[run_index]) {
+                auto pos = start[run_index];
+
+                heap.emplace_back(
+                    cursor{run_index, pos, line_for(run_index, pos)});
+                part_size += end[run_index] - start[run_index];
+            }
+        }
+        part.reserve(part_size);
+        std::make_heap(heap.begin(), heap.end(), cursor_cmp);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), cursor_cmp);
+
+            auto& top = heap.back();
+            const auto& run = runs[top.c_run];
+
+            part.emplace_back(run[top.c_pos]);
+            top.c_pos += 1;
+            if (top.c_pos < end[top.c_run]) {
+                top.c_line = line_for(top.c_run, top.c_pos);
+                std::push_heap(heap.begin(), heap.end(), cursor_cmp);
+            } else {
+                heap.pop_back();
+            }
+            if (part.size() % 10000 == 0) {
+                progress += 10000;
+            }
+        }
+    });
+
+    for (const auto& part : parts) {
+        for (const auto& row : part) {
+            this->lss_index.push_back(row);
+        }
+    }
+    for (const auto& file_marks : marks) {
+        for (const auto& cl : file_marks) {
+            this->lss_user_marks[&textview_curses::BM_META].insert_once(cl);
+        }
+    }
+    log_debug("merged %zu lines from %zu files in %zu partitions",
+              this->lss_index.size(),
+              files.size(),
+              part_count);
+
+    if (this->lss_sorting_observer) {
+        this->lss_sorting_observer(*this, total_lines * 2, total_lines * 2);
+    }
+}
+
 logfile_sub_source::rebuild_result
 logfile_sub_source::rebuild_index(
     nonstd::optional<ui_clock::time_point> deadline)
@@ -632,7 +951,6 @@ logfile_sub_source::rebuild_index(
 
     iterator iter;
     size_t total_lines = 0;
-    bool full_sort = false;
     int file_count = 0;
     bool force = this->lss_force_rebuild;
     auto retval = rebuild_result::rr_no_change;
@@ -669,6 +987,7 @@ logfile_sub_source::rebuild_index(
                          });
     }
 
+    auto parallel_results = this->rebuild_files_in_parallel(deadline);
     bool time_left = true;
     for (const auto file_index : file_order) {
         auto& ld = *(this->lss_files[file_index]);
@@ -682,14 +1001,37 @@ logfile_sub_source::rebuild_index(
                 retval = rebuild_result::rr_full_rebuild;
             }
         } else {
-            if (time_left && deadline && ui_clock::now() > deadline.value()) {
-                log_debug("no time left, skipping %s",
-                          lf->get_filename().c_str());
-                time_left = false;
+            auto parallel_iter = parallel_results.find(lf);
+            nonstd::optional<logfile::rebuild_result_t> file_result;
+
+            if (parallel_iter != parallel_results.end()) {
+                file_result = parallel_iter->second;
+            } else {
+                if (time_left && deadline
+                    && ui_clock::now() > deadline.value())
+                {
+                    log_debug("no time left, skipping %s",
+                              lf->get_filename().c_str());
+                    time_left = false;
+                }
+
+                if (!this->tss_view->is_paused() && time_left) {
+                    file_result = lf->rebuild_index(deadline);
+                }
+            }
+
+            if (lf->size() > ld.ld_lines_indexed
+                && (!file_result
+                    || file_result.value()
+                        == logfile::rebuild_result_t::NO_NEW_LINES))
+            {
+                // The file was inserted after some of its lines were
+                // already indexed, they still need to be merged in.
+                file_result = logfile::rebuild_result_t::NEW_LINES;
             }
 
-            if (!this->tss_view->is_paused() && time_left) {
-                switch (lf->rebuild_index(deadline)) {
+            if (file_result) {
+                switch (file_result.value()) {
                     case logfile::rebuild_result_t::NO_NEW_LINES:
                         // No changes
                         break;
@@ -714,7 +1056,7 @@ logfile_sub_source::rebuild_index(
                                     < last_indexed_line->get_timeval())
                             {
                                 log_debug(
-                                    "%s:%ld: found older lines, full "
+                                    "%s:%ld: found older lines, partial "
                                     "rebuild: %p  %lld < %lld",
                                     lf->get_filename().c_str(),
                                     ld.ld_lines_indexed,
@@ -745,7 +1087,6 @@ logfile_sub_source::rebuild_index(
                                   lf->get_filename().c_str());
                         retval = rebuild_result::rr_full_rebuild;
                         force = true;
-                        full_sort = true;
                         break;
                 }
             }
@@ -758,11 +1099,11 @@ logfile_sub_source::rebuild_index(
         return rebuild_result::rr_appended_lines;
     }
 
-    if (this->lss_index.reserve(total_lines)) {
-        force = true;
-        retval = rebuild_result::rr_full_rebuild;
-    }
+    this->lss_index.reserve(total_lines);
 
+    // Rows from the index that come after the lowest new line and need to
+    // be merged with the new lines during a partial rebuild.
+    std::vector<indexed_content> old_tail;
     auto& vis_bm = this->tss_view->get_bookmarks();
 
     if (force) {
@@ -793,30 +1134,24 @@ logfile_sub_source::rebuild_index(
                 continue;
             }
 
-            auto line_iter = lf->find_from_time(lowest_tv.value());
-
-            if (line_iter) {
-                log_debug("%s: lowest line time %ld; line %ld; size %ld",
-                          lf->get_filename().c_str(),
-                          line_iter.value()->get_timeval().tv_sec,
-                          std::distance(lf->cbegin(), line_iter.value()),
-                          lf->size());
-            }
-            ld.ld_lines_indexed
-                = std::distance(lf->cbegin(), line_iter.value_or(lf->cend()));
             remaining += lf->size() - ld.ld_lines_indexed;
         }
 
+        // The rows that are already indexed stay in order, so only the new
+        // lines need to be merged into the part of the index that comes
+        // after the oldest of them.
         auto row_iter = std::lower_bound(this->lss_index.begin(),
                                          this->lss_index.end(),
                                          *lowest_tv,
                                          logline_cmp(*this));
+        old_tail.assign(row_iter, this->lss_index.end());
         this->lss_index.shrink_to(
             std::distance(this->lss_index.begin(), row_iter));
-        log_debug("new index size %ld/%ld; remain %ld",
+        log_debug("new index size %ld/%ld; merging %ld new lines into %zu",
                   this->lss_index.ba_size,
                   this->lss_index.ba_capacity,
-                  remaining);
+                  remaining,
+                  old_tail.size());
         auto filt_row_iter = lower_bound(this->lss_filtered_index.begin(),
                                          this->lss_filtered_index.end(),
                                          *lowest_tv,
@@ -864,39 +1199,8 @@ logfile_sub_source::rebuild_index(
                 = std::max(this->lss_filename_width, lf->get_filename().size());
         }
 
-        if (full_sort) {
-            for (auto& ld : this->lss_files) {
-                auto* lf = ld->get_file_ptr();
-
-                if (lf == nullptr) {
-                    continue;
-                }
-
-                for (size_t line_index = 0; line_index < lf->size();
-                     line_index++)
-                {
-                    if ((*lf)[line_index].is_ignored()) {
-                        continue;
-                    }
-
-                    content_line_t con_line(
-                        ld->ld_file_index * MAX_LINES_PER_FILE + line_index);
-
-                    this->lss_index.push_back(con_line);
-                }
-            }
-
-            // XXX get rid of this full sort on the initial run, it's not
-            // needed unless the file is not in time-order
-            if (this->lss_sorting_observer) {
-                this->lss_sorting_observer(*this, 0, this->lss_index.size());
-            }
-            std::sort(
-                this->lss_index.begin(), this->lss_index.end(), line_cmper);
-            if (this->lss_sorting_observer) {
-                this->lss_sorting_observer(
-                    *this, this->lss_index.size(), this->lss_index.size());
-            }
+        if (this->lss_index.empty() && old_tail.empty()) {
+            this->merge_files_in_parallel();
         } else {
             kmerge_tree_c<logline, logfile_data, logfile::iterator> merge(
                 file_count);
@@ -957,6 +1261,30 @@ logfile_sub_source::rebuild_index(
                     this->lss_sorting_observer(*this, index_off, index_size);
                 }
             }
+
+            if (!old_tail.empty()) {
+                // Insert the newly merged rows into the rows that were
+                // already indexed.  Searching for each insertion point keeps
+                // the number of comparisons proportional to the new lines.
+                std::vector<indexed_content> new_rows(
+                    this->lss_index.begin() + start_size,
+                    this->lss_index.end());
+                auto old_iter = old_tail.begin();
+
+                this->lss_index.shrink_to(start_size);
+                for (const auto& row : new_rows) {
+                    auto ins_iter = std::upper_bound(
+                        old_iter, old_tail.end(), row, line_cmper);
+
+                    for (; old_iter != ins_iter; ++old_iter) {
+                        this->lss_index.push_back(*old_iter);
+                    }
+                    this->lss_index.push_back(row);
+                }
+                for (; old_iter != old_tail.end(); ++old_iter) {
+                    this->lss_index.push_back(*old_iter);
+                }
+            }
             if (this->lss_sorting_observer) {
                 this->lss_sorting_observer(*this, index_size, index_size);
             }
@@ -976,7 +1304,7 @@ logfile_sub_source::rebuild_index(
 
         this->lss_filtered_index.reserve(this->lss_index.size());
 
-        uint32_t filter_in_mask, filter_out_mask;
+        filter_mask filter_in_mask, filter_out_mask;
         this->get_filters().get_enabled_mask(filter_in_mask, filter_out_mask);
 
         if (start_size == 0 && this->lss_index_delegate != nullptr) {
@@ -1008,7 +1336,7 @@ logfile_sub_source::rebuild_index(
                     && this->check_extra_filters(ld, line_iter)))
             {
                 auto eval_res = this->eval_sql_filter(
-                    this->lss_marker_stmt.in(), ld, line_iter);
+                    this->lss_marker_expr, ld, line_iter);
                 if (eval_res.isErr()) {
                     line_iter->set_expr_mark(false);
                 } else {
@@ -1140,74 +1468,298 @@ logfile_sub_source::get_line_accel_direction(vis_line_t vl)
 }
 
 void
-logfile_sub_source::text_filters_changed()
+logfile_sub_source::reobserve_files(size_t thread_count)
 {
-    this->lss_index_generation += 1;
-
-    if (this->lss_line_meta_changed) {
-        this->invalidate_sql_filter();
-        this->lss_line_meta_changed = false;
-    }
+    std::vector<logfile_data*> files;
 
     for (auto& ld : *this) {
         auto* lf = ld->get_file_ptr();
 
         if (lf != nullptr) {
             ld->ld_filter_state.clear_deleted_filter_state();
+            files.emplace_back(ld.get());
+        }
+    }
+
+    // SQL filters are evaluated with a shared prepared statement, so they
+    // cannot be run from multiple threads.
+    if (thread_count == 1 || files.size() < 2 || this->get_sql_filter()) {
+        for (auto* ld : files) {
+            auto* lf = ld->get_file_ptr();
+
             lf->reobserve_from(lf->begin()
                                + ld->ld_filter_state.get_min_count(lf->size()));
         }
+        return;
     }
 
-    auto& vis_bm = this->tss_view->get_bookmarks();
-    uint32_t filtered_in_mask, filtered_out_mask;
+    log_debug("filtering %zu files using %zu threads",
+              files.size(),
+              thread_count);
 
-    this->get_filters().get_enabled_mask(filtered_in_mask, filtered_out_mask);
+    // The prefilter is built lazily, make sure that is done before it is
+    // shared between the workers.
+    this->get_filters().get_prefilter();
 
-    if (this->lss_index_delegate != nullptr) {
-        this->lss_index_delegate->index_start(*this);
+    // The observers update the UI, so they are detached while the workers
+    // are running and notified after everything is done.
+    std::vector<logfile_observer*> observers;
+    for (auto* ld : files) {
+        auto* lf = ld->get_file_ptr();
+
+        observers.emplace_back(lf->get_logfile_observer());
+        lf->set_logfile_observer(nullptr);
     }
-    vis_bm[&textview_curses::BM_USER_EXPR].clear();
 
-    this->lss_filtered_index.clear();
-    for (size_t index_index = 0; index_index < this->lss_index.size();
-         index_index++)
-    {
+    lnav::futures::parallel_for(
+        thread_count, files.size(), [&files](size_t file_index) {
+            auto* ld = files[file_index];
+            auto* lf = ld->get_file_ptr();
+
+            lf->reobserve_from(lf->begin()
+                               + ld->ld_filter_state.get_min_count(lf->size()));
+            ld->ld_filter_state.logline_eof(*lf);
+        });
+
+    for (size_t lpc = 0; lpc < files.size(); lpc++) {
+        auto lf = files[lpc]->get_file();
+
+        lf->set_logfile_observer(observers[lpc]);
+        if (observers[lpc] != nullptr) {
+            observers[lpc]->logfile_indexing(lf, lf->size(), lf->size());
+        }
+    }
+}
+
+void
+logfile_sub_source::build_filtered_index(const filter_mask& filter_in_mask,
+                                         const filter_mask& filter_out_mask,
+                                         size_t thread_count)
+{
+    static const size_t LINES_PER_CHUNK = 64 * 1024;
+
+    auto is_visible = [this, &filter_in_mask, &filter_out_mask](
+                          size_t index_index) {
         content_line_t cl = (content_line_t) this->lss_index[index_index];
         uint64_t line_number;
         auto ld = this->find_data(cl, line_number);
 
         if (!(*ld)->is_visible()) {
-            continue;
+            return false;
+        }
+        if (!this->tss_apply_filters) {
+            return true;
         }
 
-        auto lf = (*ld)->get_file_ptr();
-        auto line_iter = lf->begin() + line_number;
+        auto line_iter = (*ld)->get_file_ptr()->begin() + line_number;
+
+        return !(*ld)->ld_filter_state.excluded(
+                   filter_in_mask, filter_out_mask, line_number)
+            && this->check_extra_filters(ld, line_iter);
+    };
 
-        if (!this->tss_apply_filters
-            || (!(*ld)->ld_filter_state.excluded(
-                    filtered_in_mask, filtered_out_mask, line_number)
-                && this->check_extra_filters(ld, line_iter)))
+    this->lss_filtered_index.clear();
+    if (thread_count == 1 || this->lss_index.size() < 2 * LINES_PER_CHUNK) {
+        for (size_t index_index = 0; index_index < this->lss_index.size();
+             index_index++)
         {
-            auto eval_res = this->eval_sql_filter(
-                this->lss_marker_stmt.in(), ld, line_iter);
-            if (eval_res.isErr()) {
-                line_iter->set_expr_mark(false);
-            } else {
-                auto matched = eval_res.unwrap();
+            if (is_visible(index_index)) {
+                this->lss_filtered_index.push_back(index_index);
+            }
+        }
+        return;
+    }
 
-                if (matched) {
-                    line_iter->set_expr_mark(true);
-                    vis_bm[&textview_curses::BM_USER_EXPR].insert_once(
-                        vis_line_t(this->lss_filtered_index.size()));
-                } else {
-                    line_iter->set_expr_mark(false);
+    // excluded() computes the visibility of the lines lazily, so it is done
+    // for every file up front to make it safe to call from the workers.
+    if (this->tss_apply_filters) {
+        std::vector<logfile_data*> files;
+
+        for (auto& ld : *this) {
+            if (ld->get_file_ptr() != nullptr) {
+                files.emplace_back(ld.get());
+            }
+        }
+        lnav::futures::parallel_for(
+            thread_count,
+            files.size(),
+            [&files, &filter_in_mask, &filter_out_mask](size_t file_index) {
+                auto* ld = files[file_index];
+
+                ld->ld_filter_state.lfo_filter_state.update_visible(
+                    filter_in_mask,
+                    filter_out_mask,
+                    ld->get_file_ptr()->size());
+            });
+    }
+
+    auto chunk_count
+        = (this->lss_index.size() + LINES_PER_CHUNK - 1) / LINES_PER_CHUNK;
+    std::vector<std::vector<uint64_t>> chunk_bits(chunk_count);
+    // The number of visible lines before each chunk, once summed.
+    std::vector<size_t> chunk_offsets(chunk_count + 1);
+
+    lnav::futures::parallel_for(
+        thread_count, chunk_count, [&](size_t chunk) {
+            auto start = chunk * LINES_PER_CHUNK;
+            auto end
+                = std::min(start + LINES_PER_CHUNK, this->lss_index.size());
+            auto& bits = chunk_bits[chunk];
+            size_t count = 0;
+
+            bits.resize((end - start + 63) / 64);
+            for (auto index_index = start; index_index < end; index_index++) {
+                if (is_visible(index_index)) {
+                    auto offset = index_index - start;
+
+                    bits[offset / 64] |= 1ULL << (offset % 64);
+                    count += 1;
                 }
             }
-            this->lss_filtered_index.push_back(index_index);
-            if (this->lss_index_delegate != nullptr) {
-                this->lss_index_delegate->index_line(*this, lf, line_iter);
+            chunk_offsets[chunk + 1] = count;
+        });
+
+    std::partial_sum(
+        chunk_offsets.begin(), chunk_offsets.end(), chunk_offsets.begin());
+    this->lss_filtered_index.resize(chunk_offsets.back());
+
+    lnav::futures::parallel_for(
+        thread_count, chunk_count, [&](size_t chunk) {
+            auto start = chunk * LINES_PER_CHUNK;
+            auto out_index = chunk_offsets[chunk];
+            const auto& bits = chunk_bits[chunk];
+
+            for (size_t word = 0; word < bits.size(); word++) {
+                auto word_bits = bits[word];
+
+                while (word_bits != 0) {
+                    this->lss_filtered_index[out_index++]
+                        = start + word * 64 + __builtin_ctzll(word_bits);
+                    word_bits &= word_bits - 1;
+                }
             }
+        });
+}
+
+/**
+ * Find the ranges of lines in a new filtered index that were not in the old
+ * one.  Both indexes are built by walking lss_index in order, so they can be
+ * compared in a single pass.
+ */
+static std::vector<std::pair<vis_line_t, vis_line_t>>
+unsearched_ranges(const std::vector<uint32_t>& old_index,
+                  const std::vector<uint32_t>& new_index)
+{
+    static constexpr size_t MAX_RANGES = 1024;
+
+    std::vector<std::pair<vis_line_t, vis_line_t>> retval;
+    size_t old_pos = 0;
+
+    for (size_t vl = 0; vl < new_index.size(); vl++) {
+        while (old_pos < old_index.size() && old_index[old_pos] < new_index[vl])
+        {
+            old_pos += 1;
+        }
+        if (old_pos < old_index.size() && old_index[old_pos] == new_index[vl])
+        {
+            continue;
+        }
+        if (!retval.empty() && retval.back().second == vis_line_t(vl)) {
+            retval.back().second += 1_vl;
+        } else {
+            retval.emplace_back(vis_line_t(vl), vis_line_t(vl + 1));
+        }
+    }
+
+    // Each range is a separate request to the search, so merge neighbors
+    // when there are too many of them.  Searching a line again is harmless
+    // since the hits are only added once.
+    while (retval.size() > MAX_RANGES) {
+        size_t out = 0;
+
+        for (size_t lpc = 0; lpc < retval.size(); lpc += 2) {
+            retval[out] = retval[lpc];
+            if (lpc + 1 < retval.size()) {
+                retval[out].second = retval[lpc + 1].second;
+            }
+            out += 1;
+        }
+        retval.resize(out);
+    }
+
+    return retval;
+}
+
+void
+logfile_sub_source::text_filters_changed()
+{
+    static const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    this->lss_index_generation += 1;
+
+    if (this->lss_line_meta_changed) {
+        this->invalidate_sql_filter();
+        this->lss_line_meta_changed = false;
+    }
+
+    size_t thread_count = cfg.lc_indexing_threads;
+
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    this->reobserve_files(thread_count);
+
+    auto& vis_bm = this->tss_view->get_bookmarks();
+    filter_mask filtered_in_mask, filtered_out_mask;
+
+    this->get_filters().get_enabled_mask(filtered_in_mask, filtered_out_mask);
+
+    if (this->lss_index_delegate != nullptr) {
+        this->lss_index_delegate->index_start(*this);
+    }
+    vis_bm[&textview_curses::BM_USER_EXPR].clear();
+
+    // The search hits are kept by content line in lss_user_marks, so, if the
+    // last search finished, only the lines that were hidden before need to
+    // be searched.
+    auto remap_search = !this->tss_view->is_searching();
+    std::vector<uint32_t> old_filtered_index;
+
+    if (remap_search) {
+        old_filtered_index.swap(this->lss_filtered_index);
+    }
+
+    this->build_filtered_index(
+        filtered_in_mask, filtered_out_mask, thread_count);
+
+    // The SQL marker expression and the index delegate need to see the
+    // visible lines in order, so they are handled in a separate pass.
+    for (size_t vl = 0; vl < this->lss_filtered_index.size(); vl++) {
+        content_line_t cl
+            = (content_line_t) this->lss_index[this->lss_filtered_index[vl]];
+        uint64_t line_number;
+        auto ld = this->find_data(cl, line_number);
+        auto* lf = (*ld)->get_file_ptr();
+        auto line_iter = lf->begin() + line_number;
+
+        auto eval_res
+            = this->eval_sql_filter(this->lss_marker_expr, ld, line_iter);
+        if (eval_res.isErr()) {
+            line_iter->set_expr_mark(false);
+        } else {
+            auto matched = eval_res.unwrap();
+
+            if (matched) {
+                line_iter->set_expr_mark(true);
+                vis_bm[&textview_curses::BM_USER_EXPR].insert_once(
+                    vis_line_t(vl));
+            } else {
+                line_iter->set_expr_mark(false);
+            }
+        }
+        if (this->lss_index_delegate != nullptr) {
+            this->lss_index_delegate->index_line(*this, lf, line_iter);
         }
     }
 
@@ -1217,7 +1769,12 @@ logfile_sub_source::text_filters_changed()
 
     if (this->tss_view != nullptr) {
         this->tss_view->reload_data();
-        this->tss_view->redo_search();
+        if (remap_search) {
+            this->tss_view->search_ranges(unsearched_ranges(
+                old_filtered_index, this->lss_filtered_index));
+        } else {
+            this->tss_view->redo_search();
+        }
     }
 }
 
@@ -1257,6 +1814,45 @@ logfile_sub_source::get_grepper()
         (grep_proc_sink<vis_line_t>*) &this->lss_meta_grepper);
 }
 
+void
+logfile_sub_source::text_search_literals(
+    const std::vector<std::string>& folded_literals)
+{
+    this->lss_search_query = trigram_index::query(folded_literals);
+    for (auto& ld : *this) {
+        ld->ld_search_blocks = {};
+    }
+}
+
+bool
+logfile_sub_source::text_line_might_match(vis_line_t row)
+{
+    if (this->lss_search_query.empty()
+        || row >= (ssize_t) this->lss_filtered_index.size())
+    {
+        return true;
+    }
+
+    auto cl = this->at(row);
+    auto ld = this->find_data(cl);
+    auto* lf = (*ld)->get_file_ptr();
+    if (lf == nullptr) {
+        return true;
+    }
+
+    const auto* ti = lf->get_trigram_index();
+    if (ti == nullptr) {
+        return true;
+    }
+
+    auto& bs = (*ld)->ld_search_blocks;
+    if ((size_t) cl >= bs.get_line_count()) {
+        ti->update(this->lss_search_query, bs);
+    }
+
+    return bs.might_contain(cl);
+}
+
 bool
 logfile_sub_source::insert_file(const std::shared_ptr<logfile>& lf)
 {
@@ -1272,14 +1868,16 @@ logfile_sub_source::insert_file(const std::shared_ptr<logfile>& lf)
             return false;
         }
 
+        // The lines in a new file are merged into the existing index
+        // during the next rebuild, so there is no need to force a full one.
         auto ld = std::make_unique<logfile_data>(
             this->lss_files.size(), this->get_filters(), lf);
         ld->set_visibility(lf->get_open_options().loo_is_visible);
         this->lss_files.push_back(std::move(ld));
     } else {
         (*existing)->set_file(lf);
+        this->lss_force_rebuild = true;
     }
-    this->lss_force_rebuild = true;
 
     return true;
 }
@@ -1290,14 +1888,14 @@ logfile_sub_source::set_sql_filter(std::string stmt_str, sqlite3_stmt* stmt)
     for (auto& filt : this->tss_filters) {
         log_debug("set filt %p %d", filt.get(), filt->lf_deleted);
     }
-    if (stmt != nullptr && !this->lss_filtered_index.empty()) {
+    sql_filter_expr expr(stmt);
+    if (expr && !this->lss_filtered_index.empty()) {
         auto top_cl = this->at(0_vl);
         auto ld = this->find_data(top_cl);
         auto eval_res
-            = this->eval_sql_filter(stmt, ld, (*ld)->get_file_ptr()->begin());
+            = this->eval_sql_filter(expr, ld, (*ld)->get_file_ptr()->begin());
 
         if (eval_res.isErr()) {
-            sqlite3_finalize(stmt);
             return Err(eval_res.unwrapErr());
         }
     }
@@ -1307,9 +1905,10 @@ logfile_sub_source::set_sql_filter(std::string stmt_str, sqlite3_stmt* stmt)
     }
 
     auto old_filter = this->get_sql_filter();
-    if (stmt != nullptr) {
-        auto new_filter
-            = std::make_shared<sql_filter>(*this, std::move(stmt_str), stmt);
+    if (expr) {
+        log_debug("sql filter is compiled: %d", expr.is_compiled());
+        auto new_filter = std::make_shared<sql_filter>(
+            *this, std::move(stmt_str), std::move(expr));
 
         log_debug("fstack %p new %p", &this->tss_filters, new_filter.get());
         if (old_filter) {
@@ -1330,20 +1929,20 @@ logfile_sub_source::set_sql_filter(std::string stmt_str, sqlite3_stmt* stmt)
 Result<void, lnav::console::user_message>
 logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
 {
-    if (stmt != nullptr && !this->lss_filtered_index.empty()) {
+    sql_filter_expr expr(stmt);
+    if (expr && !this->lss_filtered_index.empty()) {
         auto top_cl = this->at(0_vl);
         auto ld = this->find_data(top_cl);
         auto eval_res
-            = this->eval_sql_filter(stmt, ld, (*ld)->get_file_ptr()->begin());
+            = this->eval_sql_filter(expr, ld, (*ld)->get_file_ptr()->begin());
 
         if (eval_res.isErr()) {
-            sqlite3_finalize(stmt);
             return Err(eval_res.unwrapErr());
         }
     }
 
     this->lss_marker_stmt_text = std::move(stmt_str);
-    this->lss_marker_stmt = stmt;
+    this->lss_marker_expr = std::move(expr);
 
     if (this->tss_view == nullptr) {
         return Ok();
@@ -1362,8 +1961,7 @@ logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
         auto cl = this->at(row);
         auto ld = this->find_data(cl);
         auto ll = (*ld)->get_file()->begin() + cl;
-        auto eval_res
-            = this->eval_sql_filter(this->lss_marker_stmt.in(), ld, ll);
+        auto eval_res = this->eval_sql_filter(this->lss_marker_expr, ld, ll);
 
         if (eval_res.isErr()) {
             ll->set_expr_mark(false);
@@ -1392,232 +1990,261 @@ logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
 Result<void, lnav::console::user_message>
 logfile_sub_source::set_preview_sql_filter(sqlite3_stmt* stmt)
 {
-    if (stmt != nullptr && !this->lss_filtered_index.empty()) {
+    sql_filter_expr expr(stmt);
+    if (expr && !this->lss_filtered_index.empty()) {
         auto top_cl = this->at(0_vl);
         auto ld = this->find_data(top_cl);
         auto eval_res
-            = this->eval_sql_filter(stmt, ld, (*ld)->get_file_ptr()->begin());
+            = this->eval_sql_filter(expr, ld, (*ld)->get_file_ptr()->begin());
 
         if (eval_res.isErr()) {
-            sqlite3_finalize(stmt);
             return Err(eval_res.unwrapErr());
         }
     }
 
-    this->lss_preview_filter_stmt = stmt;
+    this->lss_preview_filter_expr = std::move(expr);
 
     return Ok();
 }
 
 Result<bool, lnav::console::user_message>
-logfile_sub_source::eval_sql_filter(sqlite3_stmt* stmt,
+logfile_sub_source::eval_sql_filter(const sql_filter_expr& expr,
                                     iterator ld,
                                     logfile::const_iterator ll)
 {
-    if (stmt == nullptr) {
+    if (!expr) {
         return Ok(false);
     }
 
     auto* lf = (*ld)->get_file_ptr();
+    auto compiled_res = expr.eval(*lf, ll);
+    if (compiled_res) {
+        return Ok(compiled_res.value());
+    }
+
+    auto* stmt = expr.get_stmt();
     char timestamp_buffer[64];
     shared_buffer_ref raw_sbr;
     logline_value_vector values;
     auto& sbr = values.lvv_sbr;
-    lf->read_full_message(ll, sbr);
-    sbr.erase_ansi();
+    if (expr.needs_message()) {
+        lf->read_full_message(ll, sbr);
+        sbr.erase_ansi();
+    }
     auto format = lf->get_format();
     string_attrs_t sa;
     auto line_number = std::distance(lf->cbegin(), ll);
-    format->annotate(line_number, sa, values);
+    if (expr.needs_annotation()) {
+        format->annotate(line_number, sa, values);
+    }
 
     sqlite3_reset(stmt);
     sqlite3_clear_bindings(stmt);
 
-    auto count = sqlite3_bind_parameter_count(stmt);
-    for (int lpc = 0; lpc < count; lpc++) {
-        const auto* name = sqlite3_bind_parameter_name(stmt, lpc + 1);
+    const auto& params = expr.get_params();
+    for (size_t lpc = 0; lpc < params.size(); lpc++) {
+        const auto& pm = params[lpc];
 
-        if (name[0] == '$') {
-            const char* env_value;
+        switch (pm.p_kind) {
+            case sql_filter_expr::param_t::ENV: {
+                const char* env_value;
 
-            if ((env_value = getenv(&name[1])) != nullptr) {
-                sqlite3_bind_text(stmt, lpc + 1, env_value, -1, SQLITE_STATIC);
+                if ((env_value = getenv(pm.p_name.c_str())) != nullptr) {
+                    sqlite3_bind_text(
+                        stmt, lpc + 1, env_value, -1, SQLITE_STATIC);
+                }
+                break;
             }
-            continue;
-        }
-        if (strcmp(name, ":log_level") == 0) {
-            sqlite3_bind_text(
-                stmt, lpc + 1, ll->get_level_name(), -1, SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_time") == 0) {
-            auto len = sql_strftime(timestamp_buffer,
-                                    sizeof(timestamp_buffer),
-                                    ll->get_timeval(),
-                                    'T');
-            sqlite3_bind_text(
-                stmt, lpc + 1, timestamp_buffer, len, SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_time_msecs") == 0) {
-            sqlite3_bind_int64(stmt, lpc + 1, ll->get_time_in_millis());
-            continue;
-        }
-        if (strcmp(name, ":log_mark") == 0) {
-            sqlite3_bind_int(stmt, lpc + 1, ll->is_marked());
-            continue;
-        }
-        if (strcmp(name, ":log_comment") == 0) {
-            const auto& bm = lf->get_bookmark_metadata();
-            auto line_number
-                = static_cast<uint32_t>(std::distance(lf->cbegin(), ll));
-            auto bm_iter = bm.find(line_number);
-            if (bm_iter != bm.end() && !bm_iter->second.bm_comment.empty()) {
-                const auto& meta = bm_iter->second;
-                sqlite3_bind_text(stmt,
-                                  lpc + 1,
-                                  meta.bm_comment.c_str(),
-                                  meta.bm_comment.length(),
-                                  SQLITE_STATIC);
+            case sql_filter_expr::param_t::LOG_LEVEL: {
+                sqlite3_bind_text(
+                    stmt, lpc + 1, ll->get_level_name(), -1, SQLITE_STATIC);
+                break;
             }
-            continue;
-        }
-        if (strcmp(name, ":log_tags") == 0) {
-            const auto& bm = lf->get_bookmark_metadata();
-            auto line_number
-                = static_cast<uint32_t>(std::distance(lf->cbegin(), ll));
-            auto bm_iter = bm.find(line_number);
-            if (bm_iter != bm.end() && !bm_iter->second.bm_tags.empty()) {
-                const auto& meta = bm_iter->second;
-                yajlpp_gen gen;
+            case sql_filter_expr::param_t::LOG_TIME: {
+                auto len = sql_strftime(timestamp_buffer,
+                                        sizeof(timestamp_buffer),
+                                        ll->get_timeval(),
+                                        'T');
+                sqlite3_bind_text(
+                    stmt, lpc + 1, timestamp_buffer, len, SQLITE_STATIC);
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_TIME_MSECS: {
+                sqlite3_bind_int64(stmt, lpc + 1, ll->get_time_in_millis());
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_MARK: {
+                sqlite3_bind_int(stmt, lpc + 1, ll->is_marked());
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_COMMENT: {
+                const auto& bm = lf->get_bookmark_metadata();
+                auto line_number
+                    = static_cast<uint32_t>(std::distance(lf->cbegin(), ll));
+                auto bm_iter = bm.find(line_number);
+                if (bm_iter != bm.end()
+                    && !bm_iter->second.bm_comment.empty())
+                {
+                    const auto& meta = bm_iter->second;
+                    sqlite3_bind_text(stmt,
+                                      lpc + 1,
+                                      meta.bm_comment.c_str(),
+                                      meta.bm_comment.length(),
+                                      SQLITE_STATIC);
+                }
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_TAGS: {
+                const auto& bm = lf->get_bookmark_metadata();
+                auto line_number
+                    = static_cast<uint32_t>(std::distance(lf->cbegin(), ll));
+                auto bm_iter = bm.find(line_number);
+                if (bm_iter != bm.end() && !bm_iter->second.bm_tags.empty())
+                {
+                    const auto& meta = bm_iter->second;
+                    yajlpp_gen gen;
 
-                yajl_gen_config(gen, yajl_gen_beautify, false);
+                    yajl_gen_config(gen, yajl_gen_beautify, false);
 
-                {
-                    yajlpp_array arr(gen);
+                    {
+                        yajlpp_array arr(gen);
 
-                    for (const auto& str : meta.bm_tags) {
-                        arr.gen(str);
+                        for (const auto& str : meta.bm_tags) {
+                            arr.gen(str);
+                        }
                     }
-                }
 
-                string_fragment sf = gen.to_string_fragment();
+                    string_fragment sf = gen.to_string_fragment();
 
-                sqlite3_bind_text(
-                    stmt, lpc + 1, sf.data(), sf.length(), SQLITE_TRANSIENT);
+                    sqlite3_bind_text(stmt,
+                                      lpc + 1,
+                                      sf.data(),
+                                      sf.length(),
+                                      SQLITE_TRANSIENT);
+                }
+                break;
             }
-            continue;
-        }
-        if (strcmp(name, ":log_format") == 0) {
-            const auto format_name = format->get_name();
-            sqlite3_bind_text(stmt,
-                              lpc + 1,
-                              format_name.get(),
-                              format_name.size(),
-                              SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_format_regex") == 0) {
-            const auto pat_name = format->get_pattern_name(line_number);
-            sqlite3_bind_text(
-                stmt, lpc + 1, pat_name.get(), pat_name.size(), SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_path") == 0) {
-            const auto& filename = lf->get_filename();
-            sqlite3_bind_text(stmt,
-                              lpc + 1,
-                              filename.c_str(),
-                              filename.length(),
-                              SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_unique_path") == 0) {
-            const auto& filename = lf->get_unique_path();
-            sqlite3_bind_text(stmt,
-                              lpc + 1,
-                              filename.c_str(),
-                              filename.length(),
-                              SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_text") == 0) {
-            sqlite3_bind_text(
-                stmt, lpc + 1, sbr.get_data(), sbr.length(), SQLITE_STATIC);
-            continue;
-        }
-        if (strcmp(name, ":log_body") == 0) {
-            auto body_attr_opt = get_string_attr(sa, SA_BODY);
-            if (body_attr_opt) {
-                const auto& sar
-                    = body_attr_opt.value().saw_string_attr->sa_range;
-
+            case sql_filter_expr::param_t::LOG_FORMAT: {
+                const auto format_name = format->get_name();
                 sqlite3_bind_text(stmt,
                                   lpc + 1,
-                                  sbr.get_data_at(sar.lr_start),
-                                  sar.length(),
+                                  format_name.get(),
+                                  format_name.size(),
                                   SQLITE_STATIC);
-            } else {
-                sqlite3_bind_null(stmt, lpc + 1);
+                break;
             }
-            continue;
-        }
-        if (strcmp(name, ":log_opid") == 0) {
-            auto opid_attr_opt = get_string_attr(sa, logline::L_OPID);
-            if (opid_attr_opt) {
-                const auto& sar
-                    = opid_attr_opt.value().saw_string_attr->sa_range;
-
+            case sql_filter_expr::param_t::LOG_FORMAT_REGEX: {
+                const auto pat_name = format->get_pattern_name(line_number);
                 sqlite3_bind_text(stmt,
                                   lpc + 1,
-                                  sbr.get_data_at(sar.lr_start),
-                                  sar.length(),
+                                  pat_name.get(),
+                                  pat_name.size(),
                                   SQLITE_STATIC);
-            } else {
-                sqlite3_bind_null(stmt, lpc + 1);
+                break;
             }
-            continue;
-        }
-        if (strcmp(name, ":log_raw_text") == 0) {
-            auto res = lf->read_raw_message(ll);
-
-            if (res.isOk()) {
-                raw_sbr = res.unwrap();
+            case sql_filter_expr::param_t::LOG_PATH: {
+                const auto& filename = lf->get_filename();
                 sqlite3_bind_text(stmt,
                                   lpc + 1,
-                                  raw_sbr.get_data(),
-                                  raw_sbr.length(),
+                                  filename.c_str(),
+                                  filename.length(),
                                   SQLITE_STATIC);
+                break;
             }
-            continue;
-        }
-        for (const auto& lv : values.lvv_values) {
-            if (lv.lv_meta.lvm_name != &name[1]) {
-                continue;
+            case sql_filter_expr::param_t::LOG_UNIQUE_PATH: {
+                const auto& filename = lf->get_unique_path();
+                sqlite3_bind_text(stmt,
+                                  lpc + 1,
+                                  filename.c_str(),
+                                  filename.length(),
+                                  SQLITE_STATIC);
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_TEXT: {
+                sqlite3_bind_text(stmt,
+                                  lpc + 1,
+                                  sbr.get_data(),
+                                  sbr.length(),
+                                  SQLITE_STATIC);
+                break;
             }
+            case sql_filter_expr::param_t::LOG_BODY: {
+                auto body_attr_opt = get_string_attr(sa, SA_BODY);
+                if (body_attr_opt) {
+                    const auto& sar
+                        = body_attr_opt.value().saw_string_attr->sa_range;
 
-            switch (lv.lv_meta.lvm_kind) {
-                case value_kind_t::VALUE_BOOLEAN:
-                    sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
-                    break;
-                case value_kind_t::VALUE_FLOAT:
-                    sqlite3_bind_double(stmt, lpc + 1, lv.lv_value.d);
-                    break;
-                case value_kind_t::VALUE_INTEGER:
-                    sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
-                    break;
-                case value_kind_t::VALUE_NULL:
+                    sqlite3_bind_text(stmt,
+                                      lpc + 1,
+                                      sbr.get_data_at(sar.lr_start),
+                                      sar.length(),
+                                      SQLITE_STATIC);
+                } else {
                     sqlite3_bind_null(stmt, lpc + 1);
-                    break;
-                default:
+                }
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_OPID: {
+                auto opid_attr_opt = get_string_attr(sa, logline::L_OPID);
+                if (opid_attr_opt) {
+                    const auto& sar
+                        = opid_attr_opt.value().saw_string_attr->sa_range;
+
                     sqlite3_bind_text(stmt,
                                       lpc + 1,
-                                      lv.text_value(),
-                                      lv.text_length(),
-                                      SQLITE_TRANSIENT);
+                                      sbr.get_data_at(sar.lr_start),
+                                      sar.length(),
+                                      SQLITE_STATIC);
+                } else {
+                    sqlite3_bind_null(stmt, lpc + 1);
+                }
+                break;
+            }
+            case sql_filter_expr::param_t::LOG_RAW_TEXT: {
+                auto res = lf->read_raw_message(ll);
+
+                if (res.isOk()) {
+                    raw_sbr = res.unwrap();
+                    sqlite3_bind_text(stmt,
+                                      lpc + 1,
+                                      raw_sbr.get_data(),
+                                      raw_sbr.length(),
+                                      SQLITE_STATIC);
+                }
+                break;
+            }
+            case sql_filter_expr::param_t::VALUE: {
+                for (const auto& lv : values.lvv_values) {
+                    if (lv.lv_meta.lvm_name != pm.p_field) {
+                        continue;
+                    }
+
+                    switch (lv.lv_meta.lvm_kind) {
+                        case value_kind_t::VALUE_BOOLEAN:
+                            sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
+                            break;
+                        case value_kind_t::VALUE_FLOAT:
+                            sqlite3_bind_double(
+                                stmt, lpc + 1, lv.lv_value.d);
+                            break;
+                        case value_kind_t::VALUE_INTEGER:
+                            sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
+                            break;
+                        case value_kind_t::VALUE_NULL:
+                            sqlite3_bind_null(stmt, lpc + 1);
+                            break;
+                        default:
+                            sqlite3_bind_text(stmt,
+                                              lpc + 1,
+                                              lv.text_value(),
+                                              lv.text_length(),
+                                              SQLITE_TRANSIENT);
+                            break;
+                    }
                     break;
+                }
+                break;
             }
-            break;
         }
     }
 
@@ -1678,23 +2305,21 @@ logfile_sub_source::text_mark(const bookmark_type_t* bm,
     }
 
     content_line_t cl = this->at(line);
-    std::vector<content_line_t>::iterator lb;
+    auto& bv = this->lss_user_marks[bm];
 
     if (bm == &textview_curses::BM_USER) {
         logline* ll = this->find_line(cl);
 
         ll->set_mark(added);
     }
-    lb = std::lower_bound(
-        this->lss_user_marks[bm].begin(), this->lss_user_marks[bm].end(), cl);
     if (added) {
-        if (lb == this->lss_user_marks[bm].end() || *lb != cl) {
-            this->lss_user_marks[bm].insert(lb, cl);
-        }
-    } else if (lb != this->lss_user_marks[bm].end() && *lb == cl) {
-        require(lb != this->lss_user_marks[bm].end());
+        bv.insert_once(cl);
+    } else {
+        auto lb = std::lower_bound(bv.begin(), bv.end(), cl);
 
-        this->lss_user_marks[bm].erase(lb);
+        if (lb != bv.end() && *lb == cl) {
+            bv.erase(lb);
+        }
     }
     if (bm == &textview_curses::BM_META
         && this->lss_meta_grepper.gps_proc != nullptr)
@@ -1889,6 +2514,35 @@ log_location_history::loc_history_forward(vis_line_t current_top)
     return nonstd::nullopt;
 }
 
+bool
+pcre_filter::matches(const logfile& lf,
+                     logfile::const_iterator ll,
+                     shared_buffer_ref& line)
+{
+    const auto* ti = this->pf_query.empty() ? nullptr : lf.get_trigram_index();
+
+    if (ti != nullptr) {
+        size_t line_number = std::distance(lf.begin(), ll);
+        trigram_index::block_set* bs;
+
+        {
+            std::lock_guard<std::mutex> lg(this->pf_mutex);
+
+            bs = &this->pf_blocks[&lf];
+        }
+        if (line_number >= bs->get_line_count()) {
+            ti->update(this->pf_query, *bs);
+        }
+        if (!bs->might_contain(line_number)) {
+            return false;
+        }
+    }
+
+    return this->pf_pcre->find_in(line.to_string_fragment())
+        .ignore_error()
+        .has_value();
+}
+
 bool
 sql_filter::matches(const logfile& lf,
                     logfile::const_iterator ll,
@@ -1897,7 +2551,7 @@ sql_filter::matches(const logfile& lf,
     if (!ll->is_message()) {
         return false;
     }
-    if (this->sf_filter_stmt == nullptr) {
+    if (!this->sf_filter_expr) {
         return false;
     }
 
@@ -1908,7 +2562,7 @@ sql_filter::matches(const logfile& lf,
     }
 
     auto eval_res
-        = this->sf_log_source.eval_sql_filter(this->sf_filter_stmt, ld, ll);
+        = this->sf_log_source.eval_sql_filter(this->sf_filter_expr, ld, ll);
     if (eval_res.unwrapOr(true)) {
         return false;
     }
@@ -35,7 +35,9 @@
 #include <array>
 #include <list>
 #include <map>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -52,6 +54,7 @@
 #include "log_accel.hh"
 #include "log_format.hh"
 #include "logfile.hh"
+#include "sql_filter_expr.hh"
 #include "strong_int.hh"
 #include "textview_curses.hh"
 
@@ -87,7 +90,9 @@ public:
                 size_t index,
                 std::shared_ptr<lnav::pcre2pp::code> code)
         : text_filter(type, filter_lang_t::REGEX, id, index),
-          pf_pcre(std::move(code))
+          pf_pcre(std::move(code)),
+          pf_literals(this->pf_pcre->get_required_folded_literals()),
+          pf_query(this->pf_literals)
     {
     }
 
@@ -95,11 +100,11 @@ public:
 
     bool matches(const logfile& lf,
                  logfile::const_iterator ll,
-                 shared_buffer_ref& line) override
+                 shared_buffer_ref& line) override;
+
+    std::vector<std::string> get_required_literals() const override
     {
-        return this->pf_pcre->find_in(line.to_string_fragment())
-            .ignore_error()
-            .has_value();
+        return this->pf_literals;
     }
 
     std::string to_command() const override
@@ -111,17 +116,24 @@ public:
 
 protected:
     std::shared_ptr<lnav::pcre2pp::code> pf_pcre;
+    std::vector<std::string> pf_literals;
+    trigram_index::query pf_query;
+    /**
+     * The blocks in each file that might match the pattern.  Files can be
+     * filtered in parallel, so the map is guarded by pf_mutex.
+     */
+    std::unordered_map<const logfile*, trigram_index::block_set> pf_blocks;
+    std::mutex pf_mutex;
 };
 
 class sql_filter : public text_filter {
 public:
     sql_filter(logfile_sub_source& lss,
                std::string stmt_str,
-               sqlite3_stmt* stmt)
+               sql_filter_expr expr)
         : text_filter(EXCLUDE, filter_lang_t::SQL, std::move(stmt_str), 0),
-          sf_log_source(lss)
+          sf_filter_expr(std::move(expr)), sf_log_source(lss)
     {
-        this->sf_filter_stmt = stmt;
     }
 
     bool matches(const logfile& lf,
@@ -130,7 +142,7 @@ public:
 
     std::string to_command() const override;
 
-    auto_mem<sqlite3_stmt> sf_filter_stmt{sqlite3_finalize};
+    sql_filter_expr sf_filter_expr;
     logfile_sub_source& sf_log_source;
 };
 
@@ -445,6 +457,11 @@ public:
         return this->lss_line_size_cache[index].second;
     }
 
+    void text_search_literals(
+        const std::vector<std::string>& folded_literals) override;
+
+    bool text_line_might_match(vis_line_t row) override;
+
     void text_mark(const bookmark_type_t* bm, vis_line_t line, bool added);
 
     void text_clear_marks(const bookmark_type_t* bm);
@@ -510,7 +527,7 @@ public:
 
         for (const auto& ld : this->lss_files) {
             retval += ld->ld_filter_state.lfo_filter_state
-                          .tfs_filter_hits[filter_index];
+                          .get_filter_hits(filter_index);
         }
 
         return retval;
@@ -696,6 +713,8 @@ public:
         size_t ld_lines_indexed{0};
         size_t ld_lines_watched{0};
         bool ld_visible;
+        /** The blocks of the file that might match the current search. */
+        trigram_index::block_set ld_search_blocks;
     };
 
     using iterator = std::vector<std::unique_ptr<logfile_data>>::iterator;
@@ -813,7 +832,7 @@ public:
     void text_crumbs_for_line(int line, std::vector<breadcrumb::crumb>& crumbs);
 
     Result<bool, lnav::console::user_message> eval_sql_filter(
-        sqlite3_stmt* stmt, iterator ld, logfile::const_iterator ll);
+        const sql_filter_expr& expr, iterator ld, logfile::const_iterator ll);
 
     void invalidate_sql_filter();
 
@@ -971,6 +990,41 @@ private:
 
     bool check_extra_filters(iterator ld, logfile::iterator ll);
 
+    /**
+     * Index any new data in the log files using a pool of worker threads.
+     * The files are only indexed in parallel when more than one of them has
+     * new data and the configuration allows more than one thread.
+     *
+     * @param deadline The time by which the indexing should stop.
+     * @return The results of the rebuilds that were done in parallel.
+     */
+    std::unordered_map<const logfile*, logfile::rebuild_result_t>
+    rebuild_files_in_parallel(nonstd::optional<ui_clock::time_point> deadline);
+
+    /**
+     * Populate the empty index with the lines from all of the files.  Each
+     * file is treated as a sorted run and the runs are split into time
+     * ranges that are merged in parallel.
+     */
+    void merge_files_in_parallel();
+
+    /**
+     * Run the filters over the lines in each file that they have not seen
+     * yet.  The files are handled in parallel if the configuration allows
+     * more than one thread.
+     */
+    void reobserve_files(size_t thread_count);
+
+    /**
+     * Rebuild lss_filtered_index from the lines that pass the filters.  With
+     * more than one thread, the visibility of each chunk of the index is
+     * computed in parallel and the chunks are then copied into place at the
+     * offsets given by a prefix sum of their counts.
+     */
+    void build_filtered_index(const filter_mask& filter_in_mask,
+                              const filter_mask& filter_out_mask,
+                              size_t thread_count);
+
     size_t lss_basename_width = 0;
     size_t lss_filename_width = 0;
     unsigned long lss_flags{0};
@@ -979,10 +1033,10 @@ private:
 
     big_array<indexed_content> lss_index;
     std::vector<uint32_t> lss_filtered_index;
-    auto_mem<sqlite3_stmt> lss_preview_filter_stmt{sqlite3_finalize};
+    sql_filter_expr lss_preview_filter_expr;
 
     bookmarks<content_line_t>::type lss_user_marks;
-    auto_mem<sqlite3_stmt> lss_marker_stmt{sqlite3_finalize};
+    sql_filter_expr lss_marker_expr;
     std::string lss_marker_stmt_text;
 
     line_flags_t lss_token_flags{0};
@@ -1011,6 +1065,7 @@ private:
     index_delegate* lss_index_delegate{nullptr};
     size_t lss_longest_line{0};
     meta_grepper lss_meta_grepper;
+    trigram_index::query lss_search_query;
     log_location_history lss_location_history;
     exec_context* lss_exec_context{nullptr};
 
@@ -36,6 +36,331 @@
 namespace lnav {
 namespace pcre2pp {
 
+namespace {
+
+/**
+ * A conservative scanner for the literal strings that must be present in any
+ * subject that matches a pattern.  If the pattern uses a construct that is
+ * not understood, no literals are returned.
+ */
+class required_literal_scanner {
+public:
+    explicit required_literal_scanner(const std::string& pattern,
+                                      bool allow_caseless = false)
+        : rls_pattern(pattern), rls_allow_caseless(allow_caseless)
+    {
+    }
+
+    /** @return True if the pattern turned on caseless matching with (?i). */
+    bool saw_caseless() const { return this->rls_saw_caseless; }
+
+    std::vector<std::string> scan()
+    {
+        auto retval = this->scan_alternation();
+
+        if (this->rls_failed || this->rls_pos < this->rls_pattern.size()) {
+            retval.clear();
+        }
+
+        return retval;
+    }
+
+private:
+    char peek(size_t off = 0) const
+    {
+        if (this->rls_pos + off < this->rls_pattern.size()) {
+            return this->rls_pattern[this->rls_pos + off];
+        }
+        return '\0';
+    }
+
+    /**
+     * Consume a quantifier, if there is one.
+     *
+     * @return The minimum number of repetitions or nullopt if there was no
+     * quantifier.
+     */
+    nonstd::optional<size_t> scan_quantifier()
+    {
+        size_t min_count;
+
+        switch (this->peek()) {
+            case '*':
+            case '?':
+                min_count = 0;
+                this->rls_pos += 1;
+                break;
+            case '+':
+                min_count = 1;
+                this->rls_pos += 1;
+                break;
+            case '{': {
+                if (!isdigit(this->peek(1)) && this->peek(1) != ',') {
+                    return nonstd::nullopt;
+                }
+                auto end = this->rls_pattern.find('}', this->rls_pos);
+                if (end == std::string::npos) {
+                    return nonstd::nullopt;
+                }
+                min_count = strtoul(&this->rls_pattern[this->rls_pos + 1],
+                                    nullptr,
+                                    10);
+                this->rls_pos = end + 1;
+                break;
+            }
+            default:
+                return nonstd::nullopt;
+        }
+        if (this->peek() == '?' || this->peek() == '+') {
+            this->rls_pos += 1;
+        }
+
+        return min_count;
+    }
+
+    void skip_class()
+    {
+        this->rls_pos += 1;
+        if (this->peek() == '^') {
+            this->rls_pos += 1;
+        }
+        if (this->peek() == ']') {
+            this->rls_pos += 1;
+        }
+        while (this->rls_pos < this->rls_pattern.size()) {
+            auto ch = this->peek();
+
+            if (ch == '\\') {
+                this->rls_pos += 2;
+            } else if (ch == '[' && this->peek(1) == ':') {
+                auto end = this->rls_pattern.find(":]", this->rls_pos + 2);
+                if (end == std::string::npos) {
+                    this->rls_failed = true;
+                    return;
+                }
+                this->rls_pos = end + 2;
+            } else {
+                this->rls_pos += 1;
+                if (ch == ']') {
+                    return;
+                }
+            }
+        }
+        this->rls_failed = true;
+    }
+
+    /**
+     * Scan the group that starts at the current position.
+     *
+     * @return The literals required by the group.
+     */
+    std::vector<std::string> scan_group()
+    {
+        std::vector<std::string> retval;
+        bool required = true;
+
+        this->rls_pos += 1;
+        if (this->peek() == '?') {
+            auto next = this->peek(1);
+
+            if (next == '=' || next == '!'
+                || (next == '<' && (this->peek(2) == '=' || this->peek(2) == '!')))
+            {
+                // Lookarounds do not consume anything.
+                required = false;
+                this->rls_pos += next == '<' ? 3 : 2;
+            } else if (next == ':' || next == '>' || next == '|') {
+                if (next == '|') {
+                    required = false;
+                }
+                this->rls_pos += 2;
+            } else if (next == '<' || next == '\''
+                       || (next == 'P' && this->peek(2) == '<'))
+            {
+                auto end = this->rls_pattern.find_first_of(">'", this->rls_pos);
+                if (end == std::string::npos) {
+                    this->rls_failed = true;
+                    return retval;
+                }
+                this->rls_pos = end + 1;
+            } else if (next == '#') {
+                auto end = this->rls_pattern.find(')', this->rls_pos);
+                if (end == std::string::npos) {
+                    this->rls_failed = true;
+                } else {
+                    this->rls_pos = end + 1;
+                }
+                return retval;
+            } else {
+                // Inline options, like (?i), change how the rest of the
+                // pattern matches, so give up unless they are harmless.
+                this->rls_pos += 1;
+                while (isalpha(this->peek()) || this->peek() == '-'
+                       || this->peek() == '^')
+                {
+                    auto opt = this->peek();
+
+                    if (opt == 'i' && this->rls_allow_caseless) {
+                        this->rls_saw_caseless = true;
+                    } else if (opt == 'i' || opt == 'x' || opt == 'n') {
+                        this->rls_failed = true;
+                        return retval;
+                    }
+                    this->rls_pos += 1;
+                }
+                if (this->peek() == ')') {
+                    this->rls_pos += 1;
+                    return retval;
+                }
+                if (this->peek() != ':') {
+                    this->rls_failed = true;
+                    return retval;
+                }
+                this->rls_pos += 1;
+            }
+        } else if (this->peek() == '*') {
+            // Verbs, like (*UTF), are not supported.
+            this->rls_failed = true;
+            return retval;
+        }
+
+        auto inner = this->scan_alternation();
+        if (this->peek() != ')') {
+            this->rls_failed = true;
+            return retval;
+        }
+        this->rls_pos += 1;
+        if (required) {
+            retval = std::move(inner);
+        }
+
+        return retval;
+    }
+
+    std::vector<std::string> scan_alternation()
+    {
+        std::vector<std::string> retval;
+        std::string run;
+        bool alternation = false;
+        auto flush = [&retval, &run]() {
+            if (!run.empty()) {
+                retval.emplace_back(std::move(run));
+                run.clear();
+            }
+        };
+
+        while (!this->rls_failed && this->rls_pos < this->rls_pattern.size()
+               && this->peek() != ')')
+        {
+            auto ch = this->peek();
+            auto atom_is_char = false;
+            std::vector<std::string> atom_literals;
+
+            switch (ch) {
+                case '|':
+                    alternation = true;
+                    flush();
+                    this->rls_pos += 1;
+                    continue;
+                case '\\': {
+                    auto next = this->peek(1);
+
+                    if (next == 'Q') {
+                        auto end = this->rls_pattern.find("\\E", this->rls_pos);
+                        auto lit_end = end == std::string::npos
+                            ? this->rls_pattern.size()
+                            : end;
+
+                        atom_is_char = lit_end > this->rls_pos + 2;
+                        run.append(this->rls_pattern,
+                                   this->rls_pos + 2,
+                                   lit_end - this->rls_pos - 2);
+                        this->rls_pos = end == std::string::npos
+                            ? this->rls_pattern.size()
+                            : end + 2;
+                    } else if (isalnum(next)) {
+                        // A character type, back-reference or other escape
+                        // that does not match a fixed character.
+                        flush();
+                        this->rls_pos += 2;
+                        if (this->peek() == '{') {
+                            auto end
+                                = this->rls_pattern.find('}', this->rls_pos);
+                            if (end == std::string::npos) {
+                                this->rls_failed = true;
+                                continue;
+                            }
+                            this->rls_pos = end + 1;
+                        }
+                    } else if (next == '\0') {
+                        this->rls_failed = true;
+                        continue;
+                    } else {
+                        run.push_back(next);
+                        atom_is_char = true;
+                        this->rls_pos += 2;
+                    }
+                    break;
+                }
+                case '[':
+                    flush();
+                    this->skip_class();
+                    break;
+                case '(':
+                    flush();
+                    atom_literals = this->scan_group();
+                    break;
+                case '.':
+                case '^':
+                case '$':
+                    flush();
+                    this->rls_pos += 1;
+                    break;
+                case '*':
+                case '+':
+                case '?':
+                    this->rls_failed = true;
+                    continue;
+                default:
+                    run.push_back(ch);
+                    atom_is_char = true;
+                    this->rls_pos += 1;
+                    break;
+            }
+
+            auto quant = this->scan_quantifier();
+            if (quant) {
+                if (atom_is_char) {
+                    if (quant.value() == 0) {
+                        run.pop_back();
+                    }
+                    flush();
+                } else if (quant.value() == 0) {
+                    atom_literals.clear();
+                }
+            }
+            for (auto& lit : atom_literals) {
+                retval.emplace_back(std::move(lit));
+            }
+        }
+        flush();
+
+        if (alternation) {
+            retval.clear();
+        }
+
+        return retval;
+    }
+
+    const std::string& rls_pattern;
+    bool rls_allow_caseless;
+    size_t rls_pos{0};
+    bool rls_failed{false};
+    bool rls_saw_caseless{false};
+};
+
+}  // namespace
+
 std::string
 quote(const char* unquoted)
 {
@@ -166,6 +491,67 @@ code::get_capture_count() const
     return retval;
 }
 
+std::vector<std::string>
+code::get_required_literals() const
+{
+    static constexpr uint32_t UNSUPPORTED_OPTIONS = PCRE2_CASELESS
+        | PCRE2_EXTENDED | PCRE2_EXTENDED_MORE | PCRE2_LITERAL;
+
+    uint32_t options = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ALLOPTIONS, &options);
+    if (options & UNSUPPORTED_OPTIONS) {
+        return {};
+    }
+
+    return required_literal_scanner(this->p_pattern).scan();
+}
+
+std::vector<std::string>
+code::get_required_folded_literals() const
+{
+    static constexpr uint32_t UNSUPPORTED_OPTIONS
+        = PCRE2_EXTENDED | PCRE2_EXTENDED_MORE | PCRE2_LITERAL;
+
+    uint32_t options = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ALLOPTIONS, &options);
+    if (options & UNSUPPORTED_OPTIONS) {
+        return {};
+    }
+
+    required_literal_scanner rls(this->p_pattern, true);
+    auto literals = rls.scan();
+    auto caseless = (options & PCRE2_CASELESS) || rls.saw_caseless();
+    std::vector<std::string> retval;
+
+    for (const auto& lit : literals) {
+        std::string folded;
+
+        for (auto ch : lit) {
+            if ('A' <= ch && ch <= 'Z') {
+                ch += 'a' - 'A';
+            }
+            // Caseless matching also maps 'k' and 's' to the kelvin and long
+            // s characters and non-ASCII characters to their other cases,
+            // so they cannot be part of a literal.
+            if (caseless && (ch == 'k' || ch == 's' || (ch & 0x80))) {
+                if (!folded.empty()) {
+                    retval.emplace_back(std::move(folded));
+                    folded.clear();
+                }
+                continue;
+            }
+            folded.push_back(ch);
+        }
+        if (!folded.empty()) {
+            retval.emplace_back(std::move(folded));
+        }
+    }
+
+    return retval;
+}
+
 std::vector<string_fragment>
 code::get_captures() const
 {
@@ -269,6 +269,20 @@ public:
 
     std::vector<string_fragment> get_captures() const;
 
+    /**
+     * @return Literal strings that must be present in any subject matched by
+     * this pattern.  The pattern is scanned conservatively, so nothing is
+     * returned if it contains a construct that is not understood.
+     */
+    std::vector<std::string> get_required_literals() const;
+
+    /**
+     * @return Literal strings, folded to lowercase, that must be present in
+     * any subject matched by this pattern when case is ignored.  Unlike
+     * get_required_literals(), caseless patterns are supported.
+     */
+    std::vector<std::string> get_required_folded_literals() const;
+
     uint32_t get_match_data_capacity() const {
         return this->p_match_proto.md_ovector_count;
     }
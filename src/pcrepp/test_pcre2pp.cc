@@ -258,3 +258,80 @@ TEST_CASE("anchored")
     CHECK_FALSE(re.find_in(sub2).ignore_error().has_value());
     CHECK_FALSE(re.find_in(sub3).ignore_error().has_value());
 }
+
+TEST_CASE("get_required_literals")
+{
+    using strvec = std::vector<std::string>;
+
+    {
+        auto re = lnav::pcre2pp::code::from_const(
+            R"(^\[(?<timestamp>[^\]]+)\] (?<level>\w+) pid=\d+: (?<body>.*)$)");
+
+        CHECK(re.get_required_literals() == strvec{"[", "] ", " pid=", ": "});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(abc?d+e*(?:fg)?hi{2})");
+
+        CHECK(re.get_required_literals() == strvec{"ab", "d", "hi"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(\Q.*\E(?=x)y\.z)");
+
+        CHECK(re.get_required_literals() == strvec{".*", "y.z"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(abc|def)");
+
+        CHECK(re.get_required_literals().empty());
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"((abc|def)ghi)");
+
+        CHECK(re.get_required_literals() == strvec{"ghi"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"((?i)abc)");
+
+        CHECK(re.get_required_literals().empty());
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const("abc", PCRE2_CASELESS);
+
+        CHECK(re.get_required_literals().empty());
+    }
+}
+
+TEST_CASE("get_required_folded_literals")
+{
+    using strvec = std::vector<std::string>;
+
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(Hello, World)");
+
+        CHECK(re.get_required_folded_literals() == strvec{"hello, world"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(REQ-\d+ Done)",
+                                                  PCRE2_CASELESS);
+
+        CHECK(re.get_required_folded_literals() == strvec{"req-", " done"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"((?i)Task Queue)");
+
+        CHECK(re.get_required_folded_literals()
+              == strvec{"ta", " queue"});
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(abc|def)",
+                                                  PCRE2_CASELESS);
+
+        CHECK(re.get_required_folded_literals().empty());
+    }
+    {
+        auto re = lnav::pcre2pp::code::from_const(R"(Café Open)",
+                                                  PCRE2_CASELESS);
+
+        CHECK(re.get_required_folded_literals() == strvec{"caf", " open"});
+    }
+}
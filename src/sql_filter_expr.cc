@@ -0,0 +1,917 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "sql_filter_expr.hh"
+
+#include "config.h"
+#include "log_format.hh"
+#include "sql_util.hh"
+
+namespace {
+
+/**
+ * The possible outcomes of evaluating a node.  Since some columns can only be
+ * partially evaluated (e.g. the opid is only available as a hash), a node
+ * evaluates to the set of values it could have.
+ */
+constexpr uint8_t R_TRUE = 0x01;
+constexpr uint8_t R_FALSE = 0x02;
+constexpr uint8_t R_NULL = 0x04;
+constexpr uint8_t R_ANY = R_TRUE | R_FALSE | R_NULL;
+
+constexpr const char STMT_PREFIX[] = "SELECT 1 WHERE ";
+
+uint8_t
+result_and(uint8_t lhs, uint8_t rhs)
+{
+    uint8_t retval = 0;
+
+    if ((lhs & R_FALSE) || (rhs & R_FALSE)) {
+        retval |= R_FALSE;
+    }
+    if ((lhs & R_TRUE) && (rhs & R_TRUE)) {
+        retval |= R_TRUE;
+    }
+    if (((lhs & R_NULL) && (rhs & (R_TRUE | R_NULL)))
+        || ((rhs & R_NULL) && (lhs & (R_TRUE | R_NULL))))
+    {
+        retval |= R_NULL;
+    }
+
+    return retval;
+}
+
+uint8_t
+result_or(uint8_t lhs, uint8_t rhs)
+{
+    uint8_t retval = 0;
+
+    if ((lhs & R_TRUE) || (rhs & R_TRUE)) {
+        retval |= R_TRUE;
+    }
+    if ((lhs & R_FALSE) && (rhs & R_FALSE)) {
+        retval |= R_FALSE;
+    }
+    if (((lhs & R_NULL) && (rhs & (R_FALSE | R_NULL)))
+        || ((rhs & R_NULL) && (lhs & (R_FALSE | R_NULL))))
+    {
+        retval |= R_NULL;
+    }
+
+    return retval;
+}
+
+uint8_t
+result_not(uint8_t res)
+{
+    uint8_t retval = res & R_NULL;
+
+    if (res & R_TRUE) {
+        retval |= R_FALSE;
+    }
+    if (res & R_FALSE) {
+        retval |= R_TRUE;
+    }
+
+    return retval;
+}
+
+/**
+ * Compare two strings using the same ordering as SQLite's BINARY collation.
+ */
+int
+compare_text(const string_fragment& lhs, const string_fragment& rhs)
+{
+    auto min_len = std::min(lhs.length(), rhs.length());
+    auto rc = min_len == 0 ? 0 : memcmp(lhs.data(), rhs.data(), min_len);
+
+    if (rc == 0) {
+        if (lhs.length() < rhs.length()) {
+            rc = -1;
+        } else if (lhs.length() > rhs.length()) {
+            rc = 1;
+        }
+    }
+
+    return rc;
+}
+
+}  // namespace
+
+struct sql_filter_expr::eval_context {
+    eval_context(const logfile& lf, logfile::const_iterator ll)
+        : ec_file(lf), ec_line(ll)
+    {
+    }
+
+    const logfile& ec_file;
+    logfile::const_iterator ec_line;
+    char ec_time_buffer[64];
+    ssize_t ec_time_len{-1};
+
+    bool get_integer(const operand& op, int64_t& value_out)
+    {
+        switch (op.o_kind) {
+            case operand_kind_t::INTEGER:
+                value_out = op.o_integer;
+                return true;
+            case operand_kind_t::COLUMN:
+                switch (op.o_column) {
+                    case column_t::LOG_TIME_MSECS:
+                        value_out = this->ec_line->get_time_in_millis();
+                        return true;
+                    case column_t::LOG_MARK:
+                        value_out = this->ec_line->is_marked();
+                        return true;
+                    default:
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+
+        return false;
+    }
+
+    bool get_text(const operand& op, string_fragment& value_out)
+    {
+        switch (op.o_kind) {
+            case operand_kind_t::TEXT:
+                value_out = string_fragment::from_str(op.o_text);
+                return true;
+            case operand_kind_t::COLUMN:
+                switch (op.o_column) {
+                    case column_t::LOG_LEVEL:
+                        value_out = string_fragment::from_c_str(
+                            this->ec_line->get_level_name());
+                        return true;
+                    case column_t::LOG_TIME:
+                        if (this->ec_time_len < 0) {
+                            this->ec_time_len
+                                = sql_strftime(this->ec_time_buffer,
+                                               sizeof(this->ec_time_buffer),
+                                               this->ec_line->get_timeval(),
+                                               'T');
+                        }
+                        value_out = string_fragment::from_bytes(
+                            this->ec_time_buffer, this->ec_time_len);
+                        return true;
+                    case column_t::LOG_FORMAT: {
+                        const auto* format = this->ec_file.get_format_ptr();
+
+                        if (format == nullptr) {
+                            return false;
+                        }
+                        value_out = format->get_name().to_string_fragment();
+                        return true;
+                    }
+                    case column_t::LOG_PATH:
+                        value_out = string_fragment::from_str(
+                            this->ec_file.get_filename());
+                        return true;
+                    case column_t::LOG_UNIQUE_PATH:
+                        value_out = string_fragment::from_str(
+                            this->ec_file.get_unique_path());
+                        return true;
+                    default:
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+
+        return false;
+    }
+};
+
+bool
+sql_filter_expr::is_opid(const operand& op)
+{
+    return op.o_kind == operand_kind_t::COLUMN
+        && op.o_column == column_t::LOG_OPID;
+}
+
+sql_filter_expr::operand_kind_t
+sql_filter_expr::type_of(const operand& op)
+{
+    if (op.o_kind != operand_kind_t::COLUMN) {
+        return op.o_kind;
+    }
+
+    switch (op.o_column) {
+        case column_t::LOG_TIME_MSECS:
+        case column_t::LOG_MARK:
+            return operand_kind_t::INTEGER;
+        default:
+            return operand_kind_t::TEXT;
+    }
+}
+
+class sql_filter_expr::parser {
+public:
+    enum class token_t {
+        END,
+        ERROR,
+        LPAREN,
+        RPAREN,
+        COMMA,
+        OP,
+        AND,
+        OR,
+        NOT,
+        IN,
+        INTEGER,
+        TEXT,
+        PARAM,
+    };
+
+    parser(const char* str, std::vector<node>& nodes)
+        : p_str(str), p_nodes(nodes)
+    {
+        this->next();
+    }
+
+    bool parse()
+    {
+        size_t root;
+
+        if (!this->parse_or(root)) {
+            return false;
+        }
+
+        return this->p_token == token_t::END
+            && root + 1 == this->p_nodes.size();
+    }
+
+private:
+    void next()
+    {
+        while (isspace(this->p_str[this->p_pos])) {
+            this->p_pos += 1;
+        }
+
+        const auto* start = &this->p_str[this->p_pos];
+        auto ch = *start;
+
+        this->p_text.clear();
+        if (ch == '\0') {
+            this->p_token = token_t::END;
+            return;
+        }
+
+        this->p_pos += 1;
+        switch (ch) {
+            case '(':
+                this->p_token = token_t::LPAREN;
+                return;
+            case ')':
+                this->p_token = token_t::RPAREN;
+                return;
+            case ',':
+                this->p_token = token_t::COMMA;
+                return;
+            case '=':
+                if (this->p_str[this->p_pos] == '=') {
+                    this->p_pos += 1;
+                }
+                this->p_token = token_t::OP;
+                this->p_op = op_t::EQ;
+                return;
+            case '!':
+                if (this->p_str[this->p_pos] == '=') {
+                    this->p_pos += 1;
+                    this->p_token = token_t::OP;
+                    this->p_op = op_t::NE;
+                    return;
+                }
+                break;
+            case '<':
+                this->p_token = token_t::OP;
+                if (this->p_str[this->p_pos] == '=') {
+                    this->p_pos += 1;
+                    this->p_op = op_t::LE;
+                } else if (this->p_str[this->p_pos] == '>') {
+                    this->p_pos += 1;
+                    this->p_op = op_t::NE;
+                } else {
+                    this->p_op = op_t::LT;
+                }
+                return;
+            case '>':
+                this->p_token = token_t::OP;
+                if (this->p_str[this->p_pos] == '=') {
+                    this->p_pos += 1;
+                    this->p_op = op_t::GE;
+                } else {
+                    this->p_op = op_t::GT;
+                }
+                return;
+            case '\'':
+                while (true) {
+                    auto sch = this->p_str[this->p_pos];
+
+                    if (sch == '\0') {
+                        break;
+                    }
+                    this->p_pos += 1;
+                    if (sch == '\'') {
+                        if (this->p_str[this->p_pos] != '\'') {
+                            this->p_token = token_t::TEXT;
+                            return;
+                        }
+                        this->p_pos += 1;
+                    }
+                    this->p_text.push_back(sch);
+                }
+                break;
+            case ':': {
+                this->p_text.push_back(ch);
+                while (isalnum(this->p_str[this->p_pos])
+                       || this->p_str[this->p_pos] == '_')
+                {
+                    this->p_text.push_back(this->p_str[this->p_pos]);
+                    this->p_pos += 1;
+                }
+                if (this->p_text.size() > 1) {
+                    this->p_token = token_t::PARAM;
+                    return;
+                }
+                break;
+            }
+            default:
+                if (ch == '-' || isdigit(ch)) {
+                    this->p_text.push_back(ch);
+                    while (isdigit(this->p_str[this->p_pos])) {
+                        this->p_text.push_back(this->p_str[this->p_pos]);
+                        this->p_pos += 1;
+                    }
+                    // Only small, plain integers are supported, anything
+                    // else is left to SQLite.
+                    if (this->p_text == "-" || this->p_text.size() > 18
+                        || isalnum(this->p_str[this->p_pos])
+                        || this->p_str[this->p_pos] == '.'
+                        || this->p_str[this->p_pos] == '_')
+                    {
+                        break;
+                    }
+                    this->p_token = token_t::INTEGER;
+                    return;
+                }
+                if (isalpha(ch)) {
+                    this->p_text.push_back(ch);
+                    while (isalnum(this->p_str[this->p_pos])
+                           || this->p_str[this->p_pos] == '_')
+                    {
+                        this->p_text.push_back(this->p_str[this->p_pos]);
+                        this->p_pos += 1;
+                    }
+                    if (strcasecmp(this->p_text.c_str(), "and") == 0) {
+                        this->p_token = token_t::AND;
+                        return;
+                    }
+                    if (strcasecmp(this->p_text.c_str(), "or") == 0) {
+                        this->p_token = token_t::OR;
+                        return;
+                    }
+                    if (strcasecmp(this->p_text.c_str(), "not") == 0) {
+                        this->p_token = token_t::NOT;
+                        return;
+                    }
+                    if (strcasecmp(this->p_text.c_str(), "in") == 0) {
+                        this->p_token = token_t::IN;
+                        return;
+                    }
+                }
+                break;
+        }
+
+        this->p_token = token_t::ERROR;
+    }
+
+    bool parse_or(size_t& index_out)
+    {
+        if (!this->parse_and(index_out)) {
+            return false;
+        }
+        while (this->p_token == token_t::OR) {
+            size_t rhs;
+
+            this->next();
+            if (!this->parse_and(rhs)) {
+                return false;
+            }
+            index_out = this->add_binary(node_kind_t::OR, index_out, rhs);
+        }
+
+        return true;
+    }
+
+    bool parse_and(size_t& index_out)
+    {
+        if (!this->parse_not(index_out)) {
+            return false;
+        }
+        while (this->p_token == token_t::AND) {
+            size_t rhs;
+
+            this->next();
+            if (!this->parse_not(rhs)) {
+                return false;
+            }
+            index_out = this->add_binary(node_kind_t::AND, index_out, rhs);
+        }
+
+        return true;
+    }
+
+    bool parse_not(size_t& index_out)
+    {
+        if (this->p_token == token_t::NOT) {
+            size_t operand_index;
+
+            this->next();
+            if (!this->parse_not(operand_index)) {
+                return false;
+            }
+
+            node nd;
+
+            nd.n_kind = node_kind_t::NOT;
+            nd.n_left = operand_index;
+            index_out = this->add_node(std::move(nd));
+            return true;
+        }
+
+        return this->parse_comparison(index_out);
+    }
+
+    bool parse_comparison(size_t& index_out)
+    {
+        if (this->p_token == token_t::LPAREN) {
+            this->next();
+            if (!this->parse_or(index_out)) {
+                return false;
+            }
+            if (this->p_token != token_t::RPAREN) {
+                return false;
+            }
+            this->next();
+            return this->p_token != token_t::OP && this->p_token != token_t::IN;
+        }
+
+        node nd;
+
+        if (!this->parse_operand(nd.n_lhs)) {
+            return false;
+        }
+
+        if (this->p_token == token_t::OP) {
+            nd.n_kind = node_kind_t::COMPARE;
+            nd.n_op = this->p_op;
+            this->next();
+
+            operand rhs;
+
+            if (!this->parse_operand(rhs)) {
+                return false;
+            }
+            nd.n_rhs.emplace_back(std::move(rhs));
+            if (is_opid(nd.n_rhs.front())
+                && (nd.n_op == op_t::EQ || nd.n_op == op_t::NE))
+            {
+                std::swap(nd.n_lhs, nd.n_rhs.front());
+            }
+            if (!this->check_operands(nd, nd.n_rhs.front())) {
+                return false;
+            }
+        } else if (this->p_token == token_t::NOT
+                   || this->p_token == token_t::IN)
+        {
+            nd.n_kind = node_kind_t::IN;
+            if (this->p_token == token_t::NOT) {
+                nd.n_negated = true;
+                this->next();
+                if (this->p_token != token_t::IN) {
+                    return false;
+                }
+            }
+            this->next();
+            if (this->p_token != token_t::LPAREN) {
+                return false;
+            }
+            do {
+                operand rhs;
+
+                this->next();
+                if (this->p_token != token_t::INTEGER
+                    && this->p_token != token_t::TEXT)
+                {
+                    return false;
+                }
+                if (!this->parse_operand(rhs)
+                    || !this->check_operands(nd, rhs))
+                {
+                    return false;
+                }
+                nd.n_rhs.emplace_back(std::move(rhs));
+            } while (this->p_token == token_t::COMMA);
+            if (this->p_token != token_t::RPAREN) {
+                return false;
+            }
+            this->next();
+        } else {
+            // A bare value in a boolean context, only integers are
+            // supported since text would need to be converted.
+            if (type_of(nd.n_lhs) != operand_kind_t::INTEGER) {
+                return false;
+            }
+            nd.n_kind = node_kind_t::TRUTH;
+        }
+
+        // Chained comparisons have surprising precedence rules, leave them
+        // to SQLite.
+        if (this->p_token == token_t::OP || this->p_token == token_t::IN
+            || this->p_token == token_t::NOT)
+        {
+            return false;
+        }
+
+        index_out = this->add_node(std::move(nd));
+        return true;
+    }
+
+    bool parse_operand(operand& op_out)
+    {
+        switch (this->p_token) {
+            case token_t::INTEGER:
+                op_out.o_kind = operand_kind_t::INTEGER;
+                op_out.o_integer = std::stoll(this->p_text);
+                break;
+            case token_t::TEXT:
+                op_out.o_kind = operand_kind_t::TEXT;
+                op_out.o_text = this->p_text;
+                break;
+            case token_t::PARAM: {
+                static const struct {
+                    const char* name;
+                    column_t column;
+                } COLUMNS[] = {
+                    {":log_level", column_t::LOG_LEVEL},
+                    {":log_time", column_t::LOG_TIME},
+                    {":log_time_msecs", column_t::LOG_TIME_MSECS},
+                    {":log_mark", column_t::LOG_MARK},
+                    {":log_format", column_t::LOG_FORMAT},
+                    {":log_path", column_t::LOG_PATH},
+                    {":log_unique_path", column_t::LOG_UNIQUE_PATH},
+                    {":log_opid", column_t::LOG_OPID},
+                };
+
+                op_out.o_kind = operand_kind_t::COLUMN;
+                auto found = false;
+                for (const auto& col : COLUMNS) {
+                    if (this->p_text == col.name) {
+                        op_out.o_column = col.column;
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+        this->next();
+
+        return true;
+    }
+
+    /**
+     * Check that the operands can be compared without involving SQLite's
+     * type conversion rules.
+     */
+    static bool check_operands(const node& nd, const operand& rhs)
+    {
+        if (type_of(nd.n_lhs) != type_of(rhs)) {
+            return false;
+        }
+        if (is_opid(rhs)) {
+            return false;
+        }
+        if (is_opid(nd.n_lhs)) {
+            // Only a hash of the opid is kept in the logline, so it can
+            // only be checked for (in)equality against a literal.
+            if (rhs.o_kind != operand_kind_t::TEXT) {
+                return false;
+            }
+            if (nd.n_kind == node_kind_t::COMPARE && nd.n_op != op_t::EQ
+                && nd.n_op != op_t::NE)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t add_binary(node_kind_t kind, size_t lhs, size_t rhs)
+    {
+        node nd;
+
+        nd.n_kind = kind;
+        nd.n_left = lhs;
+        nd.n_right = rhs;
+        return this->add_node(std::move(nd));
+    }
+
+    size_t add_node(node&& nd)
+    {
+        this->p_nodes.emplace_back(std::move(nd));
+        return this->p_nodes.size() - 1;
+    }
+
+    const char* p_str;
+    size_t p_pos{0};
+    std::vector<node>& p_nodes;
+    token_t p_token{token_t::END};
+    op_t p_op{op_t::EQ};
+    std::string p_text;
+};
+
+sql_filter_expr::sql_filter_expr(sqlite3_stmt* stmt)
+{
+    static const struct {
+        const char* name;
+        param_t kind;
+    } PARAMS[] = {
+        {":log_level", param_t::LOG_LEVEL},
+        {":log_time", param_t::LOG_TIME},
+        {":log_time_msecs", param_t::LOG_TIME_MSECS},
+        {":log_mark", param_t::LOG_MARK},
+        {":log_comment", param_t::LOG_COMMENT},
+        {":log_tags", param_t::LOG_TAGS},
+        {":log_format", param_t::LOG_FORMAT},
+        {":log_format_regex", param_t::LOG_FORMAT_REGEX},
+        {":log_path", param_t::LOG_PATH},
+        {":log_unique_path", param_t::LOG_UNIQUE_PATH},
+        {":log_text", param_t::LOG_TEXT},
+        {":log_body", param_t::LOG_BODY},
+        {":log_opid", param_t::LOG_OPID},
+        {":log_raw_text", param_t::LOG_RAW_TEXT},
+    };
+
+    this->sfe_stmt = stmt;
+    if (stmt == nullptr) {
+        return;
+    }
+
+    auto count = sqlite3_bind_parameter_count(stmt);
+    for (int lpc = 0; lpc < count; lpc++) {
+        const auto* name = sqlite3_bind_parameter_name(stmt, lpc + 1);
+        param pm{param_t::VALUE};
+
+        if (name == nullptr) {
+            this->sfe_params.emplace_back(std::move(pm));
+            continue;
+        }
+        if (name[0] == '$') {
+            pm.p_kind = param_t::ENV;
+            pm.p_name = &name[1];
+            this->sfe_params.emplace_back(std::move(pm));
+            continue;
+        }
+
+        auto found = false;
+        for (const auto& builtin : PARAMS) {
+            if (strcmp(name, builtin.name) == 0) {
+                pm.p_kind = builtin.kind;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            pm.p_field = intern_string::lookup(&name[1]);
+        }
+
+        switch (pm.p_kind) {
+            case param_t::LOG_TEXT:
+                this->sfe_needs_message = true;
+                break;
+            case param_t::LOG_BODY:
+            case param_t::LOG_OPID:
+            case param_t::VALUE:
+                this->sfe_needs_message = true;
+                this->sfe_needs_annotation = true;
+                break;
+            default:
+                break;
+        }
+        this->sfe_params.emplace_back(std::move(pm));
+    }
+
+    const auto* sql = sqlite3_sql(stmt);
+    if (sql == nullptr
+        || strncmp(sql, STMT_PREFIX, sizeof(STMT_PREFIX) - 1) != 0)
+    {
+        return;
+    }
+
+    parser ps(&sql[sizeof(STMT_PREFIX) - 1], this->sfe_nodes);
+    if (!ps.parse()) {
+        this->sfe_nodes.clear();
+        return;
+    }
+
+    for (auto& nd : this->sfe_nodes) {
+        if (!is_opid(nd.n_lhs)) {
+            continue;
+        }
+        for (auto& rhs : nd.n_rhs) {
+            rhs.o_integer
+                = hash_str(rhs.o_text.c_str(), rhs.o_text.length()) & 0x3f;
+        }
+    }
+}
+
+nonstd::optional<bool>
+sql_filter_expr::eval(const logfile& lf, logfile::const_iterator ll) const
+{
+    if (this->sfe_nodes.empty()) {
+        return nonstd::nullopt;
+    }
+
+    eval_context ec(lf, ll);
+    auto res = this->eval_node(ec, this->sfe_nodes.size() - 1);
+
+    if (res == R_TRUE) {
+        return true;
+    }
+    if ((res & R_TRUE) == 0) {
+        return false;
+    }
+
+    return nonstd::nullopt;
+}
+
+uint8_t
+sql_filter_expr::eval_node(eval_context& ec, size_t index) const
+{
+    const auto& nd = this->sfe_nodes[index];
+
+    switch (nd.n_kind) {
+        case node_kind_t::AND: {
+            auto lhs = this->eval_node(ec, nd.n_left);
+
+            if (lhs == R_FALSE) {
+                return R_FALSE;
+            }
+            return result_and(lhs, this->eval_node(ec, nd.n_right));
+        }
+        case node_kind_t::OR: {
+            auto lhs = this->eval_node(ec, nd.n_left);
+
+            if (lhs == R_TRUE) {
+                return R_TRUE;
+            }
+            return result_or(lhs, this->eval_node(ec, nd.n_right));
+        }
+        case node_kind_t::NOT:
+            return result_not(this->eval_node(ec, nd.n_left));
+        case node_kind_t::TRUTH: {
+            int64_t value;
+
+            if (!ec.get_integer(nd.n_lhs, value)) {
+                return R_ANY;
+            }
+            return value != 0 ? R_TRUE : R_FALSE;
+        }
+        case node_kind_t::COMPARE:
+        case node_kind_t::IN: {
+            if (nd.n_lhs.o_kind == operand_kind_t::COLUMN
+                && nd.n_lhs.o_column == column_t::LOG_OPID)
+            {
+                auto opid = ec.ec_line->get_opid();
+
+                // A zero hash is also used for lines without an opid, so
+                // nothing can be said about them.
+                if (opid == 0) {
+                    return R_ANY;
+                }
+
+                auto maybe_equal = false;
+                for (const auto& rhs : nd.n_rhs) {
+                    if (rhs.o_integer == opid) {
+                        maybe_equal = true;
+                        break;
+                    }
+                }
+                if (maybe_equal) {
+                    return R_ANY;
+                }
+
+                // The message might not have an opid, in which case the
+                // comparison would be NULL.
+                auto negated = nd.n_negated
+                    || (nd.n_kind == node_kind_t::COMPARE
+                        && nd.n_op == op_t::NE);
+                return (negated ? R_TRUE : R_FALSE) | R_NULL;
+            }
+
+            auto matched = false;
+            for (const auto& rhs : nd.n_rhs) {
+                int rc;
+
+                if (type_of(rhs) == operand_kind_t::INTEGER) {
+                    int64_t lhs_value, rhs_value;
+
+                    if (!ec.get_integer(nd.n_lhs, lhs_value)
+                        || !ec.get_integer(rhs, rhs_value))
+                    {
+                        return R_ANY;
+                    }
+                    rc = lhs_value < rhs_value ? -1
+                        : lhs_value > rhs_value ? 1
+                                                : 0;
+                } else {
+                    string_fragment lhs_value, rhs_value;
+
+                    if (!ec.get_text(nd.n_lhs, lhs_value)
+                        || !ec.get_text(rhs, rhs_value))
+                    {
+                        return R_ANY;
+                    }
+                    rc = compare_text(lhs_value, rhs_value);
+                }
+
+                if (nd.n_kind == node_kind_t::IN) {
+                    if (rc == 0) {
+                        matched = true;
+                        break;
+                    }
+                    continue;
+                }
+
+                switch (nd.n_op) {
+                    case op_t::EQ:
+                        matched = rc == 0;
+                        break;
+                    case op_t::NE:
+                        matched = rc != 0;
+                        break;
+                    case op_t::LT:
+                        matched = rc < 0;
+                        break;
+                    case op_t::LE:
+                        matched = rc <= 0;
+                        break;
+                    case op_t::GT:
+                        matched = rc > 0;
+                        break;
+                    case op_t::GE:
+                        matched = rc >= 0;
+                        break;
+                }
+            }
+            if (nd.n_negated) {
+                matched = !matched;
+            }
+
+            return matched ? R_TRUE : R_FALSE;
+        }
+    }
+
+    return R_ANY;
+}
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_sql_filter_expr_hh
+#define lnav_sql_filter_expr_hh
+
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "base/auto_mem.hh"
+#include "base/intern_string.hh"
+#include "logfile.hh"
+#include "optional.hpp"
+
+/**
+ * A prepared ":filter-expr" / ":mark-expr" statement along with the
+ * information needed to evaluate it cheaply for each log message.
+ *
+ * The bind parameters of the statement are resolved once when the object is
+ * constructed so that evaluating a line does not need to look them up by
+ * name.  In addition, if the WHERE clause only consists of comparisons
+ * between literals and the parameters that are stored in the logline (level,
+ * time, mark, opid) or that are per-file (format, path), it is compiled into
+ * a small expression tree that can be evaluated without reading the message
+ * or stepping through SQLite.
+ */
+class sql_filter_expr {
+public:
+    enum class param_t {
+        ENV,
+        LOG_LEVEL,
+        LOG_TIME,
+        LOG_TIME_MSECS,
+        LOG_MARK,
+        LOG_COMMENT,
+        LOG_TAGS,
+        LOG_FORMAT,
+        LOG_FORMAT_REGEX,
+        LOG_PATH,
+        LOG_UNIQUE_PATH,
+        LOG_TEXT,
+        LOG_BODY,
+        LOG_OPID,
+        LOG_RAW_TEXT,
+        VALUE,
+    };
+
+    struct param {
+        param_t p_kind;
+        /** The environment variable name. */
+        std::string p_name;
+        /** The log field name, interned so it can be compared cheaply. */
+        intern_string_t p_field;
+    };
+
+    sql_filter_expr() = default;
+
+    /**
+     * @param stmt The prepared statement, ownership is transferred to this
+     *   object.
+     */
+    explicit sql_filter_expr(sqlite3_stmt* stmt);
+
+    sql_filter_expr(sql_filter_expr&& other) = default;
+    sql_filter_expr& operator=(sql_filter_expr&& other) = default;
+
+    explicit operator bool() const { return this->sfe_stmt != nullptr; }
+
+    sqlite3_stmt* get_stmt() const { return this->sfe_stmt.in(); }
+
+    const std::vector<param>& get_params() const { return this->sfe_params; }
+
+    /** @return True if the full message needs to be read for binding. */
+    bool needs_message() const { return this->sfe_needs_message; }
+
+    /** @return True if the message needs to be annotated for binding. */
+    bool needs_annotation() const { return this->sfe_needs_annotation; }
+
+    /** @return True if the WHERE clause could be compiled. */
+    bool is_compiled() const { return !this->sfe_nodes.empty(); }
+
+    /**
+     * Evaluate the compiled form of the expression against the given line.
+     * This method does not touch the statement, so it is safe to call from
+     * multiple threads.
+     *
+     * @return The result of the WHERE clause or nullopt if the expression
+     *   was not compiled or the result cannot be determined without
+     *   executing the statement.
+     */
+    nonstd::optional<bool> eval(const logfile& lf,
+                                logfile::const_iterator ll) const;
+
+private:
+    enum class column_t {
+        LOG_LEVEL,
+        LOG_TIME,
+        LOG_TIME_MSECS,
+        LOG_MARK,
+        LOG_FORMAT,
+        LOG_PATH,
+        LOG_UNIQUE_PATH,
+        LOG_OPID,
+    };
+
+    enum class operand_kind_t {
+        INTEGER,
+        TEXT,
+        COLUMN,
+    };
+
+    struct operand {
+        operand_kind_t o_kind{operand_kind_t::INTEGER};
+        column_t o_column{column_t::LOG_LEVEL};
+        /** The value of an integer or the hash of an opid literal. */
+        int64_t o_integer{0};
+        std::string o_text;
+    };
+
+    enum class op_t {
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+    };
+
+    enum class node_kind_t {
+        AND,
+        OR,
+        NOT,
+        COMPARE,
+        IN,
+        TRUTH,
+    };
+
+    struct node {
+        node_kind_t n_kind;
+        op_t n_op{op_t::EQ};
+        bool n_negated{false};
+        size_t n_left{0};
+        size_t n_right{0};
+        operand n_lhs;
+        std::vector<operand> n_rhs;
+    };
+
+    class parser;
+    struct eval_context;
+
+    static bool is_opid(const operand& op);
+    static operand_kind_t type_of(const operand& op);
+
+    uint8_t eval_node(eval_context& ec, size_t index) const;
+
+    auto_mem<sqlite3_stmt> sfe_stmt{sqlite3_finalize};
+    std::vector<param> sfe_params;
+    bool sfe_needs_message{false};
+    bool sfe_needs_annotation{false};
+    /** The expression tree, the root is the last node. */
+    std::vector<node> sfe_nodes;
+};
+
+#endif
@@ -28,6 +28,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include "textview_curses.hh"
@@ -46,82 +47,82 @@
 
 const auto REVERSE_SEARCH_OFFSET = 2000_vl;
 
+uint64_t
+text_filter::next_serial()
+{
+    static std::atomic<uint64_t> NEXT_SERIAL{1};
+
+    return NEXT_SERIAL++;
+}
+
 void
 text_filter::revert_to_last(logfile_filter_state& lfs, size_t rollback_size)
 {
-    require(lfs.tfs_lines_for_message[this->lf_index] == 0);
+    auto& fm = lfs.get_filter(this->lf_index);
 
-    lfs.tfs_message_matched[this->lf_index]
-        = lfs.tfs_last_message_matched[this->lf_index];
-    lfs.tfs_lines_for_message[this->lf_index]
-        = lfs.tfs_last_lines_for_message[this->lf_index];
+    require(fm.fm_lines_for_message == 0);
 
-    for (size_t lpc = 0; lpc < lfs.tfs_lines_for_message[this->lf_index]; lpc++)
-    {
-        if (lfs.tfs_message_matched[this->lf_index]) {
-            lfs.tfs_filter_hits[this->lf_index] -= 1;
+    fm.fm_message_matched = fm.fm_last_message_matched;
+    fm.fm_lines_for_message = fm.fm_last_lines_for_message;
+
+    for (size_t lpc = 0; lpc < fm.fm_lines_for_message; lpc++) {
+        if (fm.fm_message_matched) {
+            fm.fm_hits -= 1;
         }
-        lfs.tfs_filter_count[this->lf_index] -= 1;
-        size_t line_number = lfs.tfs_filter_count[this->lf_index];
+        fm.fm_count -= 1;
+        size_t line_number = fm.fm_count;
 
-        lfs.tfs_mask[line_number] &= ~(((uint32_t) 1) << this->lf_index);
+        lfs.set_filter_match(fm, line_number, false);
     }
-    if (lfs.tfs_lines_for_message[this->lf_index] > 0) {
-        require(lfs.tfs_lines_for_message[this->lf_index] >= rollback_size);
+    if (fm.fm_lines_for_message > 0) {
+        require(fm.fm_lines_for_message >= rollback_size);
 
-        lfs.tfs_lines_for_message[this->lf_index] -= rollback_size;
+        fm.fm_lines_for_message -= rollback_size;
     }
-    if (lfs.tfs_lines_for_message[this->lf_index] == 0) {
-        lfs.tfs_message_matched[this->lf_index] = false;
+    if (fm.fm_lines_for_message == 0) {
+        fm.fm_message_matched = false;
     }
 }
 
 void
 text_filter::add_line(logfile_filter_state& lfs,
                       logfile::const_iterator ll,
-                      shared_buffer_ref& line)
+                      shared_buffer_ref& line,
+                      bool might_match)
 {
-    bool match_state = this->matches(*lfs.tfs_logfile, ll, line);
+    bool match_state
+        = might_match && this->matches(*lfs.tfs_logfile, ll, line);
 
     if (ll->is_message()) {
         this->end_of_message(lfs);
     }
 
-    lfs.tfs_message_matched[this->lf_index]
-        = lfs.tfs_message_matched[this->lf_index] || match_state;
-    lfs.tfs_lines_for_message[this->lf_index] += 1;
+    auto& fm = lfs.get_filter(this->lf_index);
+
+    fm.fm_message_matched = fm.fm_message_matched || match_state;
+    fm.fm_lines_for_message += 1;
 }
 
 void
 text_filter::end_of_message(logfile_filter_state& lfs)
 {
-    uint32_t mask = 0;
-
-    mask = ((uint32_t) 1U << this->lf_index);
+    auto& fm = lfs.get_filter(this->lf_index);
 
-    for (size_t lpc = 0; lpc < lfs.tfs_lines_for_message[this->lf_index]; lpc++)
-    {
-        require(lfs.tfs_filter_count[this->lf_index]
-                <= lfs.tfs_logfile->size());
+    for (size_t lpc = 0; lpc < fm.fm_lines_for_message; lpc++) {
+        require(fm.fm_count <= lfs.tfs_logfile->size());
 
-        size_t line_number = lfs.tfs_filter_count[this->lf_index];
+        size_t line_number = fm.fm_count;
 
-        if (lfs.tfs_message_matched[this->lf_index]) {
-            lfs.tfs_mask[line_number] |= mask;
-        } else {
-            lfs.tfs_mask[line_number] &= ~mask;
-        }
-        lfs.tfs_filter_count[this->lf_index] += 1;
-        if (lfs.tfs_message_matched[this->lf_index]) {
-            lfs.tfs_filter_hits[this->lf_index] += 1;
+        lfs.set_filter_match(fm, line_number, fm.fm_message_matched);
+        fm.fm_count += 1;
+        if (fm.fm_message_matched) {
+            fm.fm_hits += 1;
         }
     }
-    lfs.tfs_last_message_matched[this->lf_index]
-        = lfs.tfs_message_matched[this->lf_index];
-    lfs.tfs_last_lines_for_message[this->lf_index]
-        = lfs.tfs_lines_for_message[this->lf_index];
-    lfs.tfs_message_matched[this->lf_index] = false;
-    lfs.tfs_lines_for_message[this->lf_index] = 0;
+    fm.fm_last_message_matched = fm.fm_message_matched;
+    fm.fm_last_lines_for_message = fm.fm_lines_for_message;
+    fm.fm_message_matched = false;
+    fm.fm_lines_for_message = 0;
 }
 
 const bookmark_type_t textview_curses::BM_USER("user");
@@ -268,6 +269,8 @@ textview_curses::grep_begin(grep_proc<vis_line_t>& gp,
 
     if (start != -1_vl) {
         auto& search_bv = this->tc_bookmarks[&BM_SEARCH];
+
+        search_bv.insert_batch(this->tc_pending_search_hits);
         auto pair = search_bv.equal_range(start, stop);
 
         if (pair.first != pair.second) {
@@ -290,6 +293,7 @@ textview_curses::grep_begin(grep_proc<vis_line_t>& gp,
 void
 textview_curses::grep_end_batch(grep_proc<vis_line_t>& gp)
 {
+    this->tc_bookmarks[&BM_SEARCH].insert_batch(this->tc_pending_search_hits);
     if (this->tc_follow_deadline.tv_sec
         && this->tc_follow_top == this->get_top())
     {
@@ -325,7 +329,16 @@ textview_curses::grep_match(grep_proc<vis_line_t>& gp,
                             int start,
                             int end)
 {
-    this->tc_bookmarks[&BM_SEARCH].insert_once(vis_line_t(line));
+    auto& search_bv = this->tc_bookmarks[&BM_SEARCH];
+
+    // Hits that come in order can be appended directly.  Others, like the
+    // ones found after the search wraps around, are merged in at the end of
+    // the batch so each hit does not have to shift the rest of the vector.
+    if (search_bv.empty() || search_bv.back() < line) {
+        search_bv.push_back(line);
+    } else {
+        this->tc_pending_search_hits.push_back(line);
+    }
     if (this->tc_sub_source != nullptr) {
         this->tc_sub_source->text_mark(&BM_SEARCH, line, true);
     }
@@ -772,6 +785,29 @@ textview_curses::redo_search()
     }
 }
 
+void
+textview_curses::search_ranges(
+    const std::vector<std::pair<vis_line_t, vis_line_t>>& ranges)
+{
+    auto highest_line
+        = std::max(0_vl, vis_line_t(this->get_inner_height() - 1));
+    std::vector<grep_proc<vis_line_t>*> procs;
+
+    if (this->tc_search_child) {
+        procs.emplace_back(this->tc_search_child->get_grep_proc());
+    }
+    if (this->tc_source_search_child) {
+        procs.emplace_back(this->tc_source_search_child.get());
+    }
+    for (auto* gp : procs) {
+        gp->set_highest_line(highest_line);
+        for (const auto& range : ranges) {
+            gp->queue_request(range.first, range.second);
+        }
+        gp->start();
+    }
+}
+
 bool
 textview_curses::listview_is_row_selectable(const listview_curses& lv,
                                             vis_line_t row)
@@ -873,12 +909,11 @@ empty_filter::to_command() const
     return "";
 }
 
-nonstd::optional<size_t>
+size_t
 filter_stack::next_index()
 {
-    bool used[32];
+    std::vector<bool> used(this->get_index_limit());
 
-    memset(used, 0, sizeof(used));
     for (auto& iter : *this) {
         if (iter->lf_deleted) {
             continue;
@@ -890,15 +925,24 @@ filter_stack::next_index()
 
         used[index] = true;
     }
-    for (size_t lpc = this->fs_reserved;
-         lpc < logfile_filter_state::MAX_FILTERS;
-         lpc++)
-    {
+    for (size_t lpc = this->fs_reserved; lpc < used.size(); lpc++) {
         if (!used[lpc]) {
             return lpc;
         }
     }
-    return nonstd::nullopt;
+    return std::max(this->fs_reserved, used.size());
+}
+
+size_t
+filter_stack::get_index_limit() const
+{
+    size_t retval = 0;
+
+    for (const auto& filter : this->fs_filters) {
+        retval = std::max(retval, filter->get_index() + 1);
+    }
+
+    return retval;
 }
 
 std::shared_ptr<text_filter>
@@ -932,9 +976,9 @@ filter_stack::delete_filter(const std::string& id)
 }
 
 void
-filter_stack::get_mask(uint32_t& filter_mask)
+filter_stack::get_mask(filter_mask& mask)
 {
-    filter_mask = 0;
+    mask.clear();
     for (auto& iter : *this) {
         std::shared_ptr<text_filter> tf = iter;
 
@@ -942,12 +986,10 @@ filter_stack::get_mask(uint32_t& filter_mask)
             continue;
         }
         if (tf->is_enabled()) {
-            uint32_t bit = (1UL << tf->get_index());
-
             switch (tf->get_type()) {
                 case text_filter::EXCLUDE:
                 case text_filter::INCLUDE:
-                    filter_mask |= bit;
+                    mask.set(tf->get_index());
                     break;
                 default:
                     ensure(0);
@@ -958,10 +1000,11 @@ filter_stack::get_mask(uint32_t& filter_mask)
 }
 
 void
-filter_stack::get_enabled_mask(uint32_t& filter_in_mask,
-                               uint32_t& filter_out_mask)
+filter_stack::get_enabled_mask(filter_mask& filter_in_mask,
+                               filter_mask& filter_out_mask)
 {
-    filter_in_mask = filter_out_mask = 0;
+    filter_in_mask.clear();
+    filter_out_mask.clear();
     for (auto& iter : *this) {
         std::shared_ptr<text_filter> tf = iter;
 
@@ -969,14 +1012,12 @@ filter_stack::get_enabled_mask(uint32_t& filter_in_mask,
             continue;
         }
         if (tf->is_enabled()) {
-            uint32_t bit = (1UL << tf->get_index());
-
             switch (tf->get_type()) {
                 case text_filter::EXCLUDE:
-                    filter_out_mask |= bit;
+                    filter_out_mask.set(tf->get_index());
                     break;
                 case text_filter::INCLUDE:
-                    filter_in_mask |= bit;
+                    filter_in_mask.set(tf->get_index());
                     break;
                 default:
                     ensure(0);
@@ -992,6 +1033,58 @@ filter_stack::add_filter(const std::shared_ptr<text_filter>& filter)
     this->fs_filters.push_back(filter);
 }
 
+static constexpr size_t MIN_PREFILTER_COUNT = 3;
+
+const literal_prefilter&
+filter_stack::get_prefilter()
+{
+    auto changed = !this->fs_prefilter
+        || this->fs_prefilter_serials.size() != this->fs_filters.size();
+
+    for (size_t lpc = 0; !changed && lpc < this->fs_filters.size(); lpc++) {
+        changed = this->fs_prefilter_serials[lpc]
+            != this->fs_filters[lpc]->get_serial();
+    }
+
+    if (changed) {
+        std::vector<std::vector<std::string>> groups(
+            this->get_index_limit());
+
+        size_t filters_with_literals = 0;
+
+        this->fs_prefilter_serials.clear();
+        for (const auto& filter : this->fs_filters) {
+            this->fs_prefilter_serials.emplace_back(filter->get_serial());
+            auto literals = filter->get_required_literals();
+
+            if (literals.empty()) {
+                continue;
+            }
+
+            // A line must contain all of the literals, so checking for the
+            // longest one rules out the most lines.
+            auto longest = std::max_element(
+                literals.begin(),
+                literals.end(),
+                [](const auto& lhs, const auto& rhs) {
+                    return lhs.size() < rhs.size();
+                });
+            groups[filter->get_index()].emplace_back(std::move(*longest));
+            filters_with_literals += 1;
+        }
+        // PCRE2 already searches quickly for the first characters of a
+        // single pattern, the combined scan only pays off once there are a
+        // few patterns to rule out.
+        if (filters_with_literals < MIN_PREFILTER_COUNT) {
+            groups.clear();
+            groups.resize(this->get_index_limit());
+        }
+        this->fs_prefilter.emplace(groups, true);
+    }
+
+    return this->fs_prefilter.value();
+}
+
 void
 vis_location_history::loc_history_append(vis_line_t top)
 {
@@ -1049,71 +1142,158 @@ text_sub_source::text_crumbs_for_line(int line,
 logfile_filter_state::logfile_filter_state(std::shared_ptr<logfile> lf)
     : tfs_logfile(std::move(lf))
 {
-    memset(this->tfs_filter_count, 0, sizeof(this->tfs_filter_count));
-    memset(this->tfs_filter_hits, 0, sizeof(this->tfs_filter_hits));
-    memset(this->tfs_message_matched, 0, sizeof(this->tfs_message_matched));
-    memset(this->tfs_lines_for_message, 0, sizeof(this->tfs_lines_for_message));
-    memset(this->tfs_last_message_matched,
-           0,
-           sizeof(this->tfs_last_message_matched));
-    memset(this->tfs_last_lines_for_message,
-           0,
-           sizeof(this->tfs_last_lines_for_message));
-    this->tfs_mask.reserve(64 * 1024);
 }
 
 void
 logfile_filter_state::clear()
 {
     this->tfs_logfile = nullptr;
-    memset(this->tfs_filter_count, 0, sizeof(this->tfs_filter_count));
-    memset(this->tfs_filter_hits, 0, sizeof(this->tfs_filter_hits));
-    memset(this->tfs_message_matched, 0, sizeof(this->tfs_message_matched));
-    memset(this->tfs_lines_for_message, 0, sizeof(this->tfs_lines_for_message));
-    memset(this->tfs_last_message_matched,
-           0,
-           sizeof(this->tfs_last_message_matched));
-    memset(this->tfs_last_lines_for_message,
-           0,
-           sizeof(this->tfs_last_lines_for_message));
-    this->tfs_mask.clear();
+    this->tfs_filters.clear();
     this->tfs_index.clear();
+    this->tfs_line_count = 0;
+    this->tfs_visible_chunks.clear();
 }
 
 void
 logfile_filter_state::clear_filter_state(size_t index)
 {
-    this->tfs_filter_count[index] = 0;
-    this->tfs_filter_hits[index] = 0;
-    this->tfs_message_matched[index] = false;
-    this->tfs_lines_for_message[index] = 0;
-    this->tfs_last_message_matched[index] = false;
-    this->tfs_last_lines_for_message[index] = 0;
+    if (index >= this->tfs_filters.size()) {
+        return;
+    }
+
+    auto& fm = this->tfs_filters[index];
+
+    fm.fm_count = 0;
+    fm.fm_hits = 0;
+    fm.fm_message_matched = false;
+    fm.fm_lines_for_message = 0;
+    fm.fm_last_message_matched = false;
+    fm.fm_last_lines_for_message = 0;
 }
 
 void
-logfile_filter_state::clear_deleted_filter_state(uint32_t used_mask)
+logfile_filter_state::clear_deleted_filter_state(const filter_mask& used_mask)
 {
-    for (int lpc = 0; lpc < MAX_FILTERS; lpc++) {
-        if (!(used_mask & (1L << lpc))) {
+    for (size_t lpc = 0; lpc < this->tfs_filters.size(); lpc++) {
+        if (!used_mask.test(lpc)) {
             this->clear_filter_state(lpc);
+            if (!this->tfs_filters[lpc].fm_lines.empty()) {
+                this->tfs_filters[lpc].fm_lines.clear();
+                this->tfs_visible_chunks.clear();
+            }
         }
     }
-    for (size_t lpc = 0; lpc < this->tfs_mask.size(); lpc++) {
-        this->tfs_mask[lpc] &= used_mask;
-    }
 }
 
 void
 logfile_filter_state::resize(size_t newsize)
 {
-    size_t old_mask_size = this->tfs_mask.size();
+    if (newsize < this->tfs_line_count) {
+        for (auto& fm : this->tfs_filters) {
+            fm.fm_lines.truncate(newsize);
+        }
+        this->tfs_visible_chunks.resize(
+            std::min(this->tfs_visible_chunks.size(),
+                     newsize / sparse_bitmap::CHUNK_SIZE));
+    }
+    this->tfs_line_count = newsize;
+}
+
+bool
+logfile_filter_state::has_filter_match(size_t line) const
+{
+    for (const auto& fm : this->tfs_filters) {
+        if (fm.fm_lines.test(line)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+logfile_filter_state::invalidate_visible(size_t line)
+{
+    auto chunk = line / sparse_bitmap::CHUNK_SIZE;
+
+    if (chunk < this->tfs_visible_chunks.size()) {
+        this->tfs_visible_chunks[chunk].clear();
+    }
+}
+
+const std::vector<uint64_t>&
+logfile_filter_state::get_visible_chunk(const filter_mask& filter_in_mask,
+                                        const filter_mask& filter_out_mask,
+                                        size_t chunk) const
+{
+    if (filter_in_mask != this->tfs_visible_in_mask
+        || filter_out_mask != this->tfs_visible_out_mask)
+    {
+        this->tfs_visible_in_mask = filter_in_mask;
+        this->tfs_visible_out_mask = filter_out_mask;
+        for (auto& words : this->tfs_visible_chunks) {
+            words.clear();
+        }
+    }
+
+    if (chunk >= this->tfs_visible_chunks.size()) {
+        this->tfs_visible_chunks.resize(chunk + 1);
+    }
+
+    auto& words = this->tfs_visible_chunks[chunk];
+    if (!words.empty()) {
+        return words;
+    }
+
+    if (filter_in_mask.empty()) {
+        words.assign(sparse_bitmap::WORDS_PER_CHUNK, ~0ULL);
+    } else {
+        words.assign(sparse_bitmap::WORDS_PER_CHUNK, 0);
+        filter_in_mask.for_each([this, chunk, &words](size_t index) {
+            if (index < this->tfs_filters.size()) {
+                this->tfs_filters[index].fm_lines.or_chunk_into(chunk,
+                                                                words.data());
+            }
+        });
+    }
+    if (!filter_out_mask.empty()) {
+        std::vector<uint64_t> out_words(sparse_bitmap::WORDS_PER_CHUNK);
+
+        filter_out_mask.for_each([this, chunk, &out_words](size_t index) {
+            if (index < this->tfs_filters.size()) {
+                this->tfs_filters[index].fm_lines.or_chunk_into(
+                    chunk, out_words.data());
+            }
+        });
+        for (size_t lpc = 0; lpc < words.size(); lpc++) {
+            words[lpc] &= ~out_words[lpc];
+        }
+    }
+
+    return words;
+}
+
+bool
+logfile_filter_state::excluded(const filter_mask& filter_in_mask,
+                               const filter_mask& filter_out_mask,
+                               size_t line) const
+{
+    const auto& words = this->get_visible_chunk(
+        filter_in_mask, filter_out_mask, line / sparse_bitmap::CHUNK_SIZE);
+    auto offset = line % sparse_bitmap::CHUNK_SIZE;
+
+    return ((words[offset / 64] >> (offset % 64)) & 1) == 0;
+}
 
-    this->tfs_mask.resize(newsize);
-    if (newsize > old_mask_size) {
-        memset(&this->tfs_mask[old_mask_size],
-               0,
-               sizeof(uint32_t) * (newsize - old_mask_size));
+void
+logfile_filter_state::update_visible(const filter_mask& filter_in_mask,
+                                     const filter_mask& filter_out_mask,
+                                     size_t line_count) const
+{
+    for (size_t chunk = 0; chunk * sparse_bitmap::CHUNK_SIZE < line_count;
+         chunk++)
+    {
+        this->get_visible_chunk(filter_in_mask, filter_out_mask, chunk);
     }
 }
 
@@ -36,7 +36,9 @@
 #include <vector>
 
 #include "base/func_util.hh"
+#include "base/literal_prefilter.hh"
 #include "base/lnav_log.hh"
+#include "base/sparse_bitmap.hh"
 #include "bookmarks.hh"
 #include "breadcrumb.hh"
 #include "grep_proc.hh"
@@ -52,31 +54,158 @@ class textview_curses;
 
 using vis_bookmarks = bookmarks<vis_line_t>::type;
 
+/**
+ * A set of filter indexes.
+ */
+class filter_mask {
+public:
+    void set(size_t index)
+    {
+        auto word = index / 64;
+
+        if (word >= this->fm_words.size()) {
+            this->fm_words.resize(word + 1);
+        }
+        this->fm_words[word] |= 1ULL << (index % 64);
+    }
+
+    bool test(size_t index) const
+    {
+        auto word = index / 64;
+
+        return word < this->fm_words.size()
+            && (this->fm_words[word] >> (index % 64)) & 1;
+    }
+
+    bool empty() const { return this->fm_words.empty(); }
+
+    void clear() { this->fm_words.clear(); }
+
+    template<typename F>
+    void for_each(F func) const
+    {
+        for (size_t word = 0; word < this->fm_words.size(); word++) {
+            auto bits = this->fm_words[word];
+
+            while (bits != 0) {
+                func(word * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    bool operator==(const filter_mask& rhs) const
+    {
+        return this->fm_words == rhs.fm_words;
+    }
+
+    bool operator!=(const filter_mask& rhs) const { return !(*this == rhs); }
+
+private:
+    std::vector<uint64_t> fm_words;
+};
+
 class logfile_filter_state {
 public:
+    /** The state of a single filter for the file. */
+    struct filter_matches {
+        size_t fm_count{0};
+        int fm_hits{0};
+        bool fm_message_matched{false};
+        size_t fm_lines_for_message{0};
+        bool fm_last_message_matched{false};
+        size_t fm_last_lines_for_message{0};
+        /** The lines matched by the filter. */
+        sparse_bitmap fm_lines;
+    };
+
     logfile_filter_state(std::shared_ptr<logfile> lf = nullptr);
 
     void clear();
 
     void clear_filter_state(size_t index);
 
-    void clear_deleted_filter_state(uint32_t used_mask);
+    void clear_deleted_filter_state(const filter_mask& used_mask);
 
     void resize(size_t newsize);
 
-    nonstd::optional<size_t> content_line_to_vis_line(uint32_t line);
+    filter_matches& get_filter(size_t index)
+    {
+        if (index >= this->tfs_filters.size()) {
+            this->tfs_filters.resize(index + 1);
+        }
+        return this->tfs_filters[index];
+    }
+
+    size_t get_filter_count(size_t index) const
+    {
+        return index < this->tfs_filters.size()
+            ? this->tfs_filters[index].fm_count
+            : 0;
+    }
 
-    const static int MAX_FILTERS = 32;
+    int get_filter_hits(size_t index) const
+    {
+        return index < this->tfs_filters.size()
+            ? this->tfs_filters[index].fm_hits
+            : 0;
+    }
+
+    void set_filter_match(filter_matches& fm, size_t line, bool matched)
+    {
+        if (fm.fm_lines.set(line, matched)) {
+            this->invalidate_visible(line);
+        }
+    }
+
+    bool is_filter_match(size_t index, size_t line) const
+    {
+        return index < this->tfs_filters.size()
+            && this->tfs_filters[index].fm_lines.test(line);
+    }
+
+    /** @return True if any filter matched the given line. */
+    bool has_filter_match(size_t line) const;
+
+    /**
+     * @return True if the line is hidden by the given filters.  The
+     *   visibility of the lines is computed a chunk at a time and cached
+     *   until the masks or the filter matches in the chunk change.
+     */
+    bool excluded(const filter_mask& filter_in_mask,
+                  const filter_mask& filter_out_mask,
+                  size_t line) const;
+
+    /**
+     * Compute the visibility of the lines up to line_count so that
+     * excluded() can be called from multiple threads with the same masks.
+     */
+    void update_visible(const filter_mask& filter_in_mask,
+                        const filter_mask& filter_out_mask,
+                        size_t line_count) const;
+
+    nonstd::optional<size_t> content_line_to_vis_line(uint32_t line);
 
     std::shared_ptr<logfile> tfs_logfile;
-    size_t tfs_filter_count[MAX_FILTERS];
-    int tfs_filter_hits[MAX_FILTERS];
-    bool tfs_message_matched[MAX_FILTERS];
-    size_t tfs_lines_for_message[MAX_FILTERS];
-    bool tfs_last_message_matched[MAX_FILTERS];
-    size_t tfs_last_lines_for_message[MAX_FILTERS];
-    std::vector<uint32_t> tfs_mask;
+    std::vector<filter_matches> tfs_filters;
     std::vector<uint32_t> tfs_index;
+
+private:
+    void invalidate_visible(size_t line);
+
+    const std::vector<uint64_t>& get_visible_chunk(
+        const filter_mask& filter_in_mask,
+        const filter_mask& filter_out_mask,
+        size_t chunk) const;
+
+    size_t tfs_line_count{0};
+    mutable filter_mask tfs_visible_in_mask;
+    mutable filter_mask tfs_visible_out_mask;
+    /**
+     * The visible lines for each chunk of the file, an empty chunk needs
+     * to be computed.
+     */
+    mutable std::vector<std::vector<uint64_t>> tfs_visible_chunks;
 };
 
 enum class filter_lang_t : int {
@@ -98,11 +227,15 @@ public:
     } type_t;
 
     text_filter(type_t type, filter_lang_t lang, std::string id, size_t index)
-        : lf_type(type), lf_lang(lang), lf_id(std::move(id)), lf_index(index)
+        : lf_type(type), lf_lang(lang), lf_id(std::move(id)), lf_index(index),
+          lf_serial(next_serial())
     {
     }
     virtual ~text_filter() = default;
 
+    /** @return A number that is unique to this filter object. */
+    uint64_t get_serial() const { return this->lf_serial; }
+
     type_t get_type() const { return this->lf_type; }
     filter_lang_t get_lang() const { return this->lf_lang; }
     void set_type(type_t t) { this->lf_type = t; }
@@ -117,9 +250,14 @@ public:
 
     void revert_to_last(logfile_filter_state& lfs, size_t rollback_size);
 
+    /**
+     * @param might_match False if the line is already known to not match
+     *   this filter, so matches() does not need to be called.
+     */
     void add_line(logfile_filter_state& lfs,
                   logfile_const_iterator ll,
-                  shared_buffer_ref& line);
+                  shared_buffer_ref& line,
+                  bool might_match = true);
 
     void end_of_message(logfile_filter_state& lfs);
 
@@ -130,6 +268,15 @@ public:
 
     virtual std::string to_command() const = 0;
 
+    /**
+     * @return The literals, folded to lowercase, that a line must all contain
+     *   for this filter to match it.  If empty, any line might match.
+     */
+    virtual std::vector<std::string> get_required_literals() const
+    {
+        return {};
+    }
+
     bool operator==(const std::string& rhs) const { return this->lf_id == rhs; }
 
     bool lf_deleted{false};
@@ -140,6 +287,11 @@ protected:
     filter_lang_t lf_lang;
     std::string lf_id;
     size_t lf_index;
+
+private:
+    static uint64_t next_serial();
+
+    uint64_t lf_serial;
 };
 
 class empty_filter : public text_filter {
@@ -177,13 +329,11 @@ public:
 
     bool empty() const { return this->fs_filters.empty(); };
 
-    bool full() const
-    {
-        return (this->fs_reserved + this->fs_filters.size())
-            == logfile_filter_state::MAX_FILTERS;
-    }
+    /** @return The lowest index that is not used by a filter. */
+    size_t next_index();
 
-    nonstd::optional<size_t> next_index();
+    /** @return One more than the highest index used by a filter. */
+    size_t get_index_limit() const;
 
     void add_filter(const std::shared_ptr<text_filter>& filter);
 
@@ -208,13 +358,27 @@ public:
 
     bool delete_filter(const std::string& id);
 
-    void get_mask(uint32_t& filter_mask);
+    void get_mask(filter_mask& mask);
 
-    void get_enabled_mask(uint32_t& filter_in_mask, uint32_t& filter_out_mask);
+    void get_enabled_mask(filter_mask& filter_in_mask,
+                          filter_mask& filter_out_mask);
+
+    /**
+     * @return A prefilter with a group for each filter index that is used to
+     *   find the filters that might match a line with a single pass over it.
+     */
+    const literal_prefilter& get_prefilter();
 
 private:
     const size_t fs_reserved;
     std::vector<std::shared_ptr<text_filter>> fs_filters;
+    nonstd::optional<literal_prefilter> fs_prefilter;
+    /**
+     * The serials of the filters the prefilter was built for.  Filters can
+     * be replaced through an iterator, so this is checked instead of
+     * invalidating the prefilter when the stack is changed.
+     */
+    std::vector<uint64_t> fs_prefilter_serials;
 };
 
 class text_time_translator {
@@ -333,6 +497,21 @@ public:
                                       line_flags_t raw = 0)
         = 0;
 
+    /**
+     * Called before a search is started with the literals that a line must
+     * contain to match.
+     */
+    virtual void text_search_literals(
+        const std::vector<std::string>& folded_literals)
+    {
+    }
+
+    /**
+     * @return False if the raw value of the line is known to not contain the
+     *   literals passed to text_search_literals().
+     */
+    virtual bool text_line_might_match(vis_line_t line) { return true; }
+
     /**
      * Inform the source that the given line has been marked/unmarked.  This
      * callback function can be used to translate between between visible line
@@ -578,6 +757,19 @@ public:
 
     bool grep_value_for_line(vis_line_t line, std::string& value_out);
 
+    void grep_literals(const std::vector<std::string>& folded_literals)
+    {
+        if (this->tc_sub_source != nullptr) {
+            this->tc_sub_source->text_search_literals(folded_literals);
+        }
+    }
+
+    bool grep_line_might_match(vis_line_t line)
+    {
+        return this->tc_sub_source == nullptr
+            || this->tc_sub_source->text_line_might_match(line);
+    }
+
     void grep_quiesce()
     {
         if (this->tc_sub_source != nullptr) {
@@ -613,6 +805,7 @@ public:
     void match_reset()
     {
         this->tc_bookmarks[&BM_SEARCH].clear();
+        this->tc_pending_search_hits.clear();
         if (this->tc_sub_source != nullptr) {
             this->tc_sub_source->text_clear_marks(&BM_SEARCH);
         }
@@ -667,6 +860,18 @@ public:
         }
     }
 
+    /**
+     * Search only the given ranges of lines after the lines in the view have
+     * been renumbered, like after a filter change.  The sub-source is
+     * expected to have carried over the hits for the other lines in
+     * text_update_marks().
+     *
+     * @param ranges The [start, stop) ranges of lines that have not been
+     *   searched yet.
+     */
+    void search_ranges(
+        const std::vector<std::pair<vis_line_t, vis_line_t>>& ranges);
+
     void search_new_data(vis_line_t start = -1_vl)
     {
         this->search_range(start);
@@ -739,6 +944,8 @@ protected:
     std::shared_ptr<text_delegate> tc_delegate;
 
     vis_bookmarks tc_bookmarks;
+    /** Search hits found out of order that are waiting to be merged. */
+    std::vector<vis_line_t> tc_pending_search_hits;
 
     int tc_searching{0};
     struct timeval tc_follow_deadline {
@@ -27,6 +27,9 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <chrono>
+#include <fstream>
+
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -82,6 +85,21 @@ private:
     file_range ms_range;
 };
 
+class bench_source : public grep_proc_source<vis_line_t> {
+public:
+    bool grep_value_for_line(vis_line_t line_number, string& value_out)
+    {
+        if (line_number >= (int) this->bs_lines.size()) {
+            return false;
+        }
+
+        value_out = this->bs_lines[line_number];
+        return true;
+    }
+
+    vector<string> bs_lines;
+};
+
 class my_sink : public grep_proc_sink<vis_line_t> {
 public:
     my_sink() : ms_finished(false) {}
@@ -108,47 +126,135 @@ public:
     bool ms_finished;
 };
 
+class bench_sink : public grep_proc_sink<vis_line_t> {
+public:
+    void grep_match(grep_proc<vis_line_t>& gp,
+                    vis_line_t line,
+                    int start,
+                    int end)
+    {
+        this->bs_match_count += 1;
+    }
+
+    void grep_end(grep_proc<vis_line_t>& gp) { this->bs_finished = true; }
+
+    size_t bs_match_count{0};
+    bool bs_finished{false};
+};
+
+static void
+run_search(std::shared_ptr<pollable_supervisor> psuperv,
+           grep_proc<vis_line_t>& gp,
+           const bool& finished)
+{
+    gp.queue_request();
+    gp.start();
+
+    while (!finished) {
+        vector<struct pollfd> pollfds;
+
+        psuperv->update_poll_set(pollfds);
+        poll(&pollfds[0], pollfds.size(), -1);
+
+        psuperv->check_poll_set(pollfds);
+    }
+}
+
+static void
+run_benchmark(std::shared_ptr<lnav::pcre2pp::code> co, const char* path)
+{
+    static const int ITERATIONS = 10;
+
+    auto psuperv = std::make_shared<pollable_supervisor>();
+    std::ifstream in(path);
+    bench_source bs;
+    string line;
+
+    while (std::getline(in, line)) {
+        bs.bs_lines.emplace_back(line);
+    }
+
+    for (const auto use_child : {true, false}) {
+        grep_proc_ns::config cfg;
+        size_t match_count = 0;
+
+        cfg.c_use_child_process = use_child;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int lpc = 0; lpc < ITERATIONS; lpc++) {
+            bench_sink bsink;
+            grep_proc<vis_line_t> gp(co, bs, psuperv, cfg);
+
+            gp.set_sink(&bsink);
+            run_search(psuperv, gp, bsink.bs_finished);
+            match_count = bsink.bs_match_count;
+        }
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - start;
+        auto line_count = bs.bs_lines.size() * ITERATIONS;
+        printf("%s: %zu lines (%zu matches) in %.3fs -- %.0f lines/sec\n",
+               use_child ? "child" : "threads",
+               line_count,
+               match_count,
+               elapsed.count(),
+               line_count / elapsed.count());
+    }
+}
+
 int
 main(int argc, char* argv[])
 {
     int retval = EXIT_SUCCESS;
+    grep_proc_ns::config cfg;
+    bool benchmark = false;
     auto_fd fd;
+    int c;
+
+    while ((c = getopt(argc, argv, "bf")) != -1) {
+        switch (c) {
+            case 'b':
+                benchmark = true;
+                break;
+            case 'f':
+                cfg.c_use_child_process = true;
+                break;
+            default:
+                retval = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
 
-    if (argc < 3) {
+    if (retval != EXIT_SUCCESS) {
+    } else if (argc < 2) {
         fprintf(stderr, "error: expecting pattern and file arguments\n");
         retval = EXIT_FAILURE;
-    } else if ((fd = open(argv[2], O_RDONLY)) == -1) {
+    } else if ((fd = open(argv[1], O_RDONLY)) == -1) {
         perror("open");
         retval = EXIT_FAILURE;
     } else {
         auto compile_res = lnav::pcre2pp::code::from(
-            string_fragment::from_c_str(argv[1]), PCRE2_CASELESS);
+            string_fragment::from_c_str(argv[0]), PCRE2_CASELESS);
 
         if (compile_res.isErr()) {
             auto ce = compile_res.unwrapErr();
             fprintf(stderr,
                     "error: invalid pattern -- %s\n",
                     ce.get_message().c_str());
+        } else if (benchmark) {
+            run_benchmark(compile_res.unwrap().to_shared(), argv[1]);
         } else {
             auto co = compile_res.unwrap().to_shared();
             auto psuperv = std::make_shared<pollable_supervisor>();
             my_source ms(fd);
             my_sink msink;
 
-            grep_proc<vis_line_t> gp(co, ms, psuperv);
+            grep_proc<vis_line_t> gp(co, ms, psuperv, cfg);
 
             gp.set_sink(&msink);
-            gp.queue_request();
-            gp.start();
-
-            while (!msink.ms_finished) {
-                vector<struct pollfd> pollfds;
-
-                psuperv->update_poll_set(pollfds);
-                poll(&pollfds[0], pollfds.size(), -1);
-
-                psuperv->check_poll_set(pollfds);
-            }
+            run_search(psuperv, gp, msink.ms_finished);
         }
     }
 
@@ -28,8 +28,10 @@
  */
 
 #include <algorithm>
+#include <chrono>
 
 #include <assert.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,11 +40,14 @@
 #include <unistd.h>
 
 #include "base/injector.hh"
+#include "base/isc.hh"
 #include "base/opt_util.hh"
 #include "config.h"
+#include "filter_observer.hh"
 #include "log_format.hh"
 #include "log_format_loader.hh"
 #include "logfile.hh"
+#include "logfile_sub_source.hh"
 
 using namespace std;
 
@@ -52,6 +57,8 @@ typedef enum {
     MODE_LINE_COUNT,
     MODE_TIMES,
     MODE_LEVELS,
+    MODE_BENCHMARK,
+    MODE_FILTER_BENCHMARK,
 } dl_mode_t;
 
 time_t
@@ -66,6 +73,9 @@ main(int argc, char* argv[])
     int c, retval = EXIT_SUCCESS;
     dl_mode_t mode = MODE_NONE;
     string expected_format;
+    size_t filter_count = 0;
+    // The line buffer preloads data on the I/O service thread.
+    isc::supervisor root_superv(injector::get<isc::service_list>());
 
     {
         static auto builtin_formats
@@ -87,8 +97,15 @@ main(int argc, char* argv[])
         load_formats(paths, errors);
     }
 
-    while ((c = getopt(argc, argv, "ef:ltv")) != -1) {
+    while ((c = getopt(argc, argv, "bF:ef:ltv")) != -1) {
         switch (c) {
+            case 'b':
+                mode = MODE_BENCHMARK;
+                break;
+            case 'F':
+                mode = MODE_FILTER_BENCHMARK;
+                filter_count = atoi(optarg);
+                break;
             case 'f':
                 expected_format = optarg;
                 break;
@@ -187,6 +204,77 @@ main(int argc, char* argv[])
                            level & LEVEL__FLAGS);
                 }
                 break;
+            case MODE_BENCHMARK: {
+                static const int ITERATIONS = 10;
+
+                size_t line_count = 0;
+                auto start = std::chrono::steady_clock::now();
+
+                for (int lpc = 0; lpc < ITERATIONS; lpc++) {
+                    // Open by descriptor so that the on-disk index cache is
+                    // not used.
+                    logfile_open_options bench_loo;
+                    bench_loo.with_fd(auto_fd(open(argv[0], O_RDONLY)));
+                    auto bench_lf = logfile::open(argv[0], bench_loo).unwrap();
+
+                    while (bench_lf->rebuild_index()
+                           != logfile::rebuild_result_t::NO_NEW_LINES)
+                    {
+                    }
+                    line_count += bench_lf->size();
+                }
+
+                std::chrono::duration<double> elapsed
+                    = std::chrono::steady_clock::now() - start;
+                printf("%s: %zu lines in %.3fs -- %.0f lines/sec\n",
+                       lf->get_format() != nullptr
+                           ? lf->get_format()->get_name().get()
+                           : "(none)",
+                       line_count,
+                       elapsed.count(),
+                       line_count / elapsed.count());
+                break;
+            }
+            case MODE_FILTER_BENCHMARK: {
+                static const int ITERATIONS = 10;
+
+                filter_stack fs;
+
+                for (size_t lpc = 0; lpc < filter_count; lpc++) {
+                    auto pattern = fmt::format(
+                        FMT_STRING("error {}: connection (?:reset|refused)"),
+                        lpc);
+                    auto code = lnav::pcre2pp::code::from(pattern,
+                                                          PCRE2_CASELESS)
+                                    .unwrap()
+                                    .to_shared();
+
+                    fs.add_filter(std::make_shared<pcre_filter>(
+                        text_filter::EXCLUDE, pattern, lpc, code));
+                }
+
+                line_filter_observer lfo(fs, lf);
+                size_t line_count = 0;
+
+                lf->set_logline_observer(&lfo);
+                auto start = std::chrono::steady_clock::now();
+                for (int lpc = 0; lpc < ITERATIONS; lpc++) {
+                    lfo.lfo_filter_state.clear();
+                    lfo.lfo_filter_state.tfs_logfile = lf;
+                    lf->reobserve_from(lf->begin());
+                    line_count += lf->size();
+                }
+
+                std::chrono::duration<double> elapsed
+                    = std::chrono::steady_clock::now() - start;
+                printf("%zu filters: %zu lines in %.3fs -- %.0f lines/sec\n",
+                       filter_count,
+                       line_count,
+                       elapsed.count(),
+                       line_count / elapsed.count());
+                lf->set_logline_observer(nullptr);
+                break;
+            }
         }
     }
 
@@ -105,12 +105,38 @@ main(int argc, char* argv[])
     assert(bv.prev(vis_line_t(4)).value() == 2);
     assert(!bv.prev(vis_line_t(2)));
 
+    {
+        std::vector<vis_line_t> batch = {7_vl, 1_vl, 4_vl, 3_vl, 1_vl};
+
+        bv.insert_batch(batch);
+        assert(batch.empty());
+        assert(bv.size() == 5);
+        assert(bv[0] == 1);
+        assert(bv[1] == 2);
+        assert(bv[2] == 3);
+        assert(bv[3] == 4);
+        assert(bv[4] == 7);
+    }
+
     bv.clear();
 
     const int LINE_COUNT = 10000;
 
-    for (lpc = 0; lpc < 1000; lpc++) {
-        bv.insert_once(vis_line_t(random() % LINE_COUNT));
+    {
+        std::vector<vis_line_t> batch;
+        bookmark_vector<vis_line_t> bv_batch;
+
+        for (lpc = 0; lpc < 1000; lpc++) {
+            auto vl = vis_line_t(random() % LINE_COUNT);
+
+            bv.insert_once(vl);
+            batch.emplace_back(vl);
+            if (lpc % 100 == 0) {
+                bv_batch.insert_batch(batch);
+            }
+        }
+        bv_batch.insert_batch(batch);
+        assert(bv == bv_batch);
     }
     bv_cp = bv;
     sort(bv_cp.begin(), bv_cp.end());
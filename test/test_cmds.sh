@@ -87,6 +87,15 @@ run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
     -c ":filter-expr :sc_bytes # ff" \
     "${test_dir}/logfile_access_log.*"
 
+run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
+    -c ":filter-expr NOT (:log_level = 'info' OR :log_mark = 1) AND :log_path != ''" \
+    "${test_dir}/logfile_access_log.0"
+
+run_cap_test ${lnav_test} -n \
+    -c ":mark-expr :log_level IN ('error', 'warning') AND :log_time_msecs > 0" \
+    -c ":write-to -" \
+    ${test_dir}/logfile_access_log.0
+
 run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
     -c ":goto 0" \
     -c ":close" \
@@ -301,12 +310,13 @@ run_cap_test ${lnav_test} -n \
     -c ":filter-out World" \
     ${test_dir}/logfile_plain.0
 
-TOO_MANY_FILTERS=""
-for i in `seq 1 32`; do
-    TOO_MANY_FILTERS="$TOO_MANY_FILTERS -c ':filter-out $i'"
+MANY_FILTERS=""
+for i in `seq 1 40`; do
+    MANY_FILTERS="$MANY_FILTERS -c ':filter-out nomatch-$i'"
 done
 run_cap_test eval ${lnav_test} -d /tmp/lnav.err -n \
-    $TOO_MANY_FILTERS \
+    $MANY_FILTERS \
+    -c "':filter-out dnsmasq'" \
     ${test_dir}/logfile_filter.0
 
 run_cap_test ${lnav_test} -n \
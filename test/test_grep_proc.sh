@@ -13,6 +13,14 @@ grep_capture() {
     ./drive_grep_proc "$1" "$2" 1>/dev/null
 }
 
+grep_child_slice() {
+    ./drive_grep_proc -f "$1" "$2" | ./slicer "$2"
+}
+
+grep_child_capture() {
+    ./drive_grep_proc -f "$1" "$2" 1>/dev/null
+}
+
 run_test grep_slice 'Hello' gp.dat
 
 check_output "grep_proc didn't find the right match?" <<EOF
@@ -55,3 +63,22 @@ EOF
 
 check_output "grep_proc didn't capture matches?" <<EOF
 EOF
+
+run_test grep_child_slice '\w+.' gp.dat
+
+check_output "grep_proc child didn't find multiple matches?" <<EOF
+Hello,
+World!
+Goodbye,
+World?
+EOF
+
+run_test grep_child_capture '(\w+), World' gp.dat
+
+check_error_output "grep_proc child didn't capture matches?" <<EOF
+0(0:5)Hello
+1(0:7)Goodbye
+EOF
+
+check_output "grep_proc child didn't capture matches?" <<EOF
+EOF
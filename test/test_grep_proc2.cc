@@ -119,9 +119,13 @@ main(int argc, char* argv[])
         = lnav::pcre2pp::code::from_const("foobar", PCRE2_CASELESS).to_shared();
 
     auto psuperv = std::make_shared<pollable_supervisor>();
-    {
+    for (const auto use_child : {false, true}) {
+        grep_proc_ns::config cfg;
         my_source ms;
-        grep_proc<vis_line_t> gp(code, ms, psuperv);
+
+        cfg.c_use_child_process = use_child;
+
+        grep_proc<vis_line_t> gp(code, ms, psuperv, cfg);
 
         gp.queue_request(10_vl, 14_vl);
         gp.queue_request(0_vl, 3_vl);
@@ -130,9 +134,13 @@ main(int argc, char* argv[])
     }
 
     {
+        grep_proc_ns::config cfg;
         my_sleeper_source mss;
+
+        cfg.c_use_child_process = true;
+
         grep_proc<vis_line_t>* gp
-            = new grep_proc<vis_line_t>(code, mss, psuperv);
+            = new grep_proc<vis_line_t>(code, mss, psuperv, cfg);
         int status;
 
         gp->queue_request();
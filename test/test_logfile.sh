@@ -686,6 +686,93 @@ EOF
 # 192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
 # EOF
 
+awk 'BEGIN {
+    for (lpc = 1; lpc <= 400; lpc++) {
+        printf("Jan  1 00:%02d:%02d host app[1]: line %d %s\n",
+               lpc / 60, lpc % 60, lpc,
+               (lpc % 97) == 0 ? "Needle-" lpc " found" : "haystack");
+    }
+}' > logfile_trigram.0
+
+run_test ${lnav_test} -n \
+    -c ':filter-out Haystack' \
+    -c ':filter-out needle-97' \
+    -c ':filter-out NEEDLE-1' \
+    logfile_trigram.0
+
+check_output "prefiltered filters do not work?" <<EOF
+Jan  1 00:04:51 host app[1]: line 291 Needle-291 found
+Jan  1 00:06:28 host app[1]: line 388 Needle-388 found
+EOF
+
+run_test ${lnav_test} -n \
+    -c ':config /tuning/logfile/trigram-index true' \
+    logfile_trigram.0
+
+run_test ${lnav_test} -n \
+    -c ':filter-in needle-[0-9]+' \
+    logfile_trigram.0
+
+check_output "trigram index hides matching lines?" <<EOF
+Jan  1 00:01:37 host app[1]: line 97 Needle-97 found
+Jan  1 00:03:14 host app[1]: line 194 Needle-194 found
+Jan  1 00:04:51 host app[1]: line 291 Needle-291 found
+Jan  1 00:06:28 host app[1]: line 388 Needle-388 found
+EOF
+
+run_test ${lnav_test} -n \
+    -c '/NEEDLE-29[0-9]' \
+    -c ':next-mark search' \
+    -c ':mark' \
+    -c ';SELECT log_line, log_body FROM all_logs WHERE log_mark = 1' \
+    logfile_trigram.0
+
+check_output "trigram index hides search hits?" <<EOF
+log_line         log_body
+     290 line 291 Needle-291 found
+EOF
+
+run_test ${lnav_test} -n \
+    -c ':reset-config /tuning/logfile/trigram-index' \
+    logfile_trigram.0
+
+for app in 1 2; do
+    awk -v app=$app 'BEGIN {
+        for (lpc = 1; lpc <= 70000; lpc++) {
+            printf("Jan  1 %02d:%02d:%02d host app[%d]: line %d %s\n",
+                   lpc / 3600, (lpc / 60) % 60, lpc % 60, app, lpc,
+                   (lpc % 10007) == 0 ? "Needle-" lpc " found" : "haystack");
+        }
+    }' > logfile_parallel_filter.$app
+done
+
+run_test ${lnav_test} -n \
+    -c ':config /tuning/logfile/indexing-threads 4' \
+    logfile_parallel_filter.1
+
+run_test ${lnav_test} -n \
+    -c ':filter-out haystack' \
+    -c ':filter-out Needle-30021' \
+    logfile_parallel_filter.1 \
+    logfile_parallel_filter.2
+
+check_output "filtering in parallel does not work?" <<EOF
+Jan  1 02:46:47 host app[1]: line 10007 Needle-10007 found
+Jan  1 02:46:47 host app[2]: line 10007 Needle-10007 found
+Jan  1 05:33:34 host app[1]: line 20014 Needle-20014 found
+Jan  1 05:33:34 host app[2]: line 20014 Needle-20014 found
+Jan  1 11:07:08 host app[1]: line 40028 Needle-40028 found
+Jan  1 11:07:08 host app[2]: line 40028 Needle-40028 found
+Jan  1 13:53:55 host app[1]: line 50035 Needle-50035 found
+Jan  1 13:53:55 host app[2]: line 50035 Needle-50035 found
+Jan  1 16:40:42 host app[1]: line 60042 Needle-60042 found
+Jan  1 16:40:42 host app[2]: line 60042 Needle-60042 found
+EOF
+
+run_test ${lnav_test} -n \
+    -c ':reset-config /tuning/logfile/indexing-threads' \
+    logfile_parallel_filter.1
+
 export YES_COLOR=1
 
 touch -t 202211030923 ${test_dir}/logfile_ansi.1